@@ -0,0 +1,533 @@
+// ----------------------------------------------------------------------------------------------------
+
+#include "render_ring.h"
+
+#if defined(__linux__)
+#include <new>
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <ctime>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+// ----------------------------------------------------------------------------------------------------
+
+constexpr uint32_t RING_MAGIC = 0x52524e47;
+constexpr uint32_t RING_VERSION = 1;
+constexpr uint64_t RING_ALIGNMENT = 64;
+constexpr uint64_t RING_HEADER_SIZE = 4096;
+constexpr int RING_WAIT_TIMEOUT_MS = 100;
+
+// ----------------------------------------------------------------------------------------------------
+
+struct RENDER_RING::HEADER
+{
+	uint32_t magic = RING_MAGIC;
+	uint32_t version = RING_VERSION;
+	uint64_t capacity = 0;
+	uint64_t upload_capacity = 0;
+	int32_t client_pid = 0;
+	std::atomic<int32_t> host_pid = 0;
+	std::atomic<int32_t> executed_frame_index = -1;
+
+	// written by the client
+	alignas(RING_ALIGNMENT) std::atomic<uint64_t> write_offset = 0;
+	std::atomic<uint32_t> data_sequence = 0;
+
+	// written by the host
+	alignas(RING_ALIGNMENT) std::atomic<uint64_t> read_offset = 0;
+	std::atomic<uint32_t> space_sequence = 0;
+};
+
+// ----------------------------------------------------------------------------------------------------
+
+struct RING_RECORD
+{
+	uint64_t size;
+	uint64_t padding;
+};
+
+// ----------------------------------------------------------------------------------------------------
+
+static uint64_t align_ring_size(uint64_t size)
+{
+	return (size + RING_ALIGNMENT - 1) & ~(RING_ALIGNMENT - 1);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+#if defined(__linux__)
+
+static void futex_wait(std::atomic<uint32_t>& sequence, uint32_t expected)
+{
+	// wait on shared futex so it works across processes, with timeout so peer death is noticed
+	timespec timeout = { 0, RING_WAIT_TIMEOUT_MS * 1000000L };
+	syscall(SYS_futex, (uint32_t*)&sequence, FUTEX_WAIT, expected, &timeout, nullptr, 0);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+static void futex_wake(std::atomic<uint32_t>& sequence)
+{
+	// bump sequence and wake waiters
+	sequence.fetch_add(1, std::memory_order_release);
+	syscall(SYS_futex, (uint32_t*)&sequence, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+#endif
+
+// ----------------------------------------------------------------------------------------------------
+
+RENDER_RING::~RENDER_RING()
+{
+	// close
+	close();
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+bool RENDER_RING::create(size_t capacity, size_t upload_capacity)
+{
+#if defined(__linux__)
+	// already open?
+	if (m_header)
+	{
+		return false;
+	}
+
+	// align sizes
+	capacity = (size_t)align_ring_size(capacity);
+	upload_capacity = (size_t)align_ring_size(upload_capacity);
+
+	// create shared memory, not close-on-exec so it can be inherited by the host process
+	int fd = memfd_create("render_ring", 0);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	// size shared memory
+	size_t size = (size_t)RING_HEADER_SIZE + capacity + upload_capacity;
+	if (ftruncate(fd, (off_t)size) != 0 || !map(fd, size))
+	{
+		::close(fd);
+		return false;
+	}
+
+	// initialise header
+	static_assert(sizeof(HEADER) <= RING_HEADER_SIZE, "ring header too big");
+	m_header = new (m_header) HEADER();
+	m_header->capacity = capacity;
+	m_header->upload_capacity = upload_capacity;
+	m_header->client_pid = (int32_t)getpid();
+
+	// set capacities
+	m_capacity = capacity;
+	m_upload_capacity = upload_capacity;
+	m_upload = upload_capacity ? m_data + capacity : nullptr;
+
+	return true;
+#else
+	(void)capacity;
+	(void)upload_capacity;
+	return false;
+#endif
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void* RENDER_RING::begin_write(size_t size)
+{
+	// get aligned record size
+	uint64_t total = align_ring_size(sizeof(RING_RECORD) + size);
+
+	// not open or too big?
+	if (!m_header || m_host || total > m_capacity)
+	{
+		return nullptr;
+	}
+
+	// record doesn't fit before the end of the ring?
+	uint64_t physical = m_write_pos % m_capacity;
+	uint64_t skip = physical + total > m_capacity ? m_capacity - physical : 0;
+
+	// wait for space
+	if (!wait_for_space(skip + total))
+	{
+		return nullptr;
+	}
+
+	// write padding record to skip to the start of the ring
+	if (skip)
+	{
+		RING_RECORD* padding = (RING_RECORD*)(m_data + physical);
+		padding->size = skip;
+		padding->padding = 1;
+		m_write_pos += skip;
+		physical = 0;
+	}
+
+	// write record
+	RING_RECORD* record = (RING_RECORD*)(m_data + physical);
+	record->size = total;
+	record->padding = 0;
+	m_write_size = total;
+
+	// return record data
+	return record + 1;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDER_RING::end_write()
+{
+#if defined(__linux__)
+	// publish record
+	m_write_pos += m_write_size;
+	m_write_size = 0;
+	m_header->write_offset.store(m_write_pos, std::memory_order_release);
+
+	// wake host
+	futex_wake(m_header->data_sequence);
+#endif
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void* RENDER_RING::alloc_upload(size_t size, int32_t frame_index)
+{
+#if defined(__linux__)
+	// align size
+	uint64_t aligned_size = align_ring_size(size);
+
+	// no upload heap or too big?
+	if (!m_upload || m_host || aligned_size > m_upload_capacity)
+	{
+		return nullptr;
+	}
+
+	while (true)
+	{
+		// reclaim memory from frames the host has finished executing
+		int32_t executed_frame_index = get_executed_frame_index();
+		while (!m_upload_frames.empty() && m_upload_frames.front().first <= executed_frame_index)
+		{
+			m_upload_tail = m_upload_frames.front().second;
+			m_upload_frames.pop_front();
+		}
+
+		// enough space?
+		uint64_t physical = m_upload_head % m_upload_capacity;
+		uint64_t skip = physical + aligned_size > m_upload_capacity ? m_upload_capacity - physical : 0;
+		if (m_upload_head + skip + aligned_size - m_upload_tail <= m_upload_capacity)
+		{
+			// allocate
+			m_upload_head += skip;
+			void* ptr = m_upload + m_upload_head % m_upload_capacity;
+			m_upload_head += aligned_size;
+
+			// record frame end
+			if (!m_upload_frames.empty() && m_upload_frames.back().first == frame_index)
+			{
+				m_upload_frames.back().second = m_upload_head;
+			}
+			else
+			{
+				m_upload_frames.emplace_back(frame_index, m_upload_head);
+			}
+
+			return ptr;
+		}
+
+		// only the current frame left, waiting would never free anything?
+		if (m_upload_frames.empty() || m_upload_frames.front().first >= frame_index)
+		{
+			return nullptr;
+		}
+
+		// wait for host to execute more frames
+		uint32_t sequence = m_header->space_sequence.load(std::memory_order_acquire);
+		if (get_executed_frame_index() == executed_frame_index)
+		{
+			futex_wait(m_header->space_sequence, sequence);
+		}
+
+		// host gone?
+		if (!is_peer_alive())
+		{
+			return nullptr;
+		}
+	}
+#else
+	(void)size;
+	(void)frame_index;
+	return nullptr;
+#endif
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+bool RENDER_RING::open(int fd)
+{
+#if defined(__linux__)
+	// already open?
+	if (m_header)
+	{
+		return false;
+	}
+
+	// get size
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < RING_HEADER_SIZE || !map(fd, (size_t)st.st_size))
+	{
+		return false;
+	}
+
+	// check header, the client isn't trusted so the capacities mustn't overflow
+	uint64_t capacity = m_header->capacity;
+	uint64_t upload_capacity = m_header->upload_capacity;
+	if (m_header->magic != RING_MAGIC || m_header->version != RING_VERSION || !capacity || align_ring_size(capacity) != capacity || capacity > (uint64_t)st.st_size - RING_HEADER_SIZE || upload_capacity != (uint64_t)st.st_size - RING_HEADER_SIZE - capacity)
+	{
+		close();
+		return false;
+	}
+
+	// set capacities
+	m_capacity = capacity;
+	m_upload_capacity = upload_capacity;
+	m_upload = m_upload_capacity ? m_data + m_capacity : nullptr;
+
+	// register host
+	m_host = true;
+	m_read_pos = m_header->read_offset.load(std::memory_order_acquire);
+	m_header->host_pid.store((int32_t)getpid(), std::memory_order_release);
+
+	return true;
+#else
+	(void)fd;
+	return false;
+#endif
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+const void* RENDER_RING::begin_read(size_t& size)
+{
+#if defined(__linux__)
+	// not open as host?
+	if (!m_header || !m_host)
+	{
+		return nullptr;
+	}
+
+	while (true)
+	{
+		// no data?
+		uint32_t sequence = m_header->data_sequence.load(std::memory_order_acquire);
+		uint64_t write_offset = m_header->write_offset.load(std::memory_order_acquire);
+		if (write_offset == m_read_pos)
+		{
+			// wait for data
+			futex_wait(m_header->data_sequence, sequence);
+
+			// client gone?
+			if (m_header->write_offset.load(std::memory_order_acquire) == m_read_pos && !is_peer_alive())
+			{
+				return nullptr;
+			}
+			continue;
+		}
+
+		// get record, copying the header as the client could change it under us
+		uint64_t physical = m_read_pos % m_capacity;
+		const RING_RECORD* record = (const RING_RECORD*)(m_data + physical);
+		uint64_t record_size = ((const volatile RING_RECORD*)record)->size;
+		uint64_t record_padding = ((const volatile RING_RECORD*)record)->padding;
+
+		// corrupt record? it must be aligned, written and not cross the end of the ring
+		if (write_offset - m_read_pos > m_capacity || record_size < sizeof(RING_RECORD) || align_ring_size(record_size) != record_size || record_size > m_capacity - physical || record_size > write_offset - m_read_pos)
+		{
+			return nullptr;
+		}
+
+		// skip padding
+		if (record_padding)
+		{
+			m_read_pos += record_size;
+			continue;
+		}
+
+		// return record data
+		m_read_size = record_size;
+		size = (size_t)(record_size - sizeof(RING_RECORD));
+		return record + 1;
+	}
+#else
+	(void)size;
+	return nullptr;
+#endif
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDER_RING::end_read()
+{
+#if defined(__linux__)
+	// release record
+	m_read_pos += m_read_size;
+	m_read_size = 0;
+	m_header->read_offset.store(m_read_pos, std::memory_order_release);
+
+	// wake client
+	futex_wake(m_header->space_sequence);
+#endif
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDER_RING::set_executed_frame_index(int32_t frame_index)
+{
+#if defined(__linux__)
+	// publish executed frame and wake client
+	m_header->executed_frame_index.store(frame_index, std::memory_order_release);
+	futex_wake(m_header->space_sequence);
+#else
+	(void)frame_index;
+#endif
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDER_RING::close()
+{
+#if defined(__linux__)
+	// unmap, a host that stops reading tells the client it's gone
+	if (m_header)
+	{
+		if (m_host)
+		{
+			m_header->host_pid.store(-1, std::memory_order_release);
+		}
+		munmap(m_header, m_size);
+	}
+
+	// close
+	if (m_fd >= 0)
+	{
+		::close(m_fd);
+	}
+#endif
+
+	// reset
+	m_fd = -1;
+	m_size = 0;
+	m_header = nullptr;
+	m_data = nullptr;
+	m_capacity = 0;
+	m_upload = nullptr;
+	m_upload_capacity = 0;
+	m_host = false;
+	m_write_pos = 0;
+	m_write_size = 0;
+	m_read_pos = 0;
+	m_read_size = 0;
+	m_upload_head = 0;
+	m_upload_tail = 0;
+	m_upload_frames.clear();
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+bool RENDER_RING::is_peer_alive() const
+{
+#if defined(__linux__)
+	// not open?
+	if (!m_header)
+	{
+		return false;
+	}
+
+	// host not connected yet counts as alive, one that closed the ring doesn't
+	int32_t pid = m_host ? m_header->client_pid : m_header->host_pid.load(std::memory_order_acquire);
+	if (!pid)
+	{
+		return true;
+	}
+	if (pid < 0)
+	{
+		return false;
+	}
+
+	// check process exists
+	return kill((pid_t)pid, 0) == 0 || errno == EPERM;
+#else
+	return false;
+#endif
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+int32_t RENDER_RING::get_executed_frame_index() const
+{
+	return m_header ? m_header->executed_frame_index.load(std::memory_order_acquire) : -1;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+bool RENDER_RING::map(int fd, size_t size)
+{
+#if defined(__linux__)
+	// map shared memory
+	void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (ptr == MAP_FAILED)
+	{
+		return false;
+	}
+
+	// set pointers
+	m_fd = fd;
+	m_size = size;
+	m_header = (HEADER*)ptr;
+	m_data = (uint8_t*)ptr + RING_HEADER_SIZE;
+
+	return true;
+#else
+	(void)fd;
+	(void)size;
+	return false;
+#endif
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+bool RENDER_RING::wait_for_space(uint64_t size)
+{
+#if defined(__linux__)
+	while (true)
+	{
+		// enough space?
+		uint32_t sequence = m_header->space_sequence.load(std::memory_order_acquire);
+		if (m_write_pos + size - m_header->read_offset.load(std::memory_order_acquire) <= m_capacity)
+		{
+			return true;
+		}
+
+		// wait for host to read
+		futex_wait(m_header->space_sequence, sequence);
+
+		// host gone?
+		if (!is_peer_alive())
+		{
+			return false;
+		}
+	}
+#else
+	(void)size;
+	return false;
+#endif
+}
@@ -0,0 +1,77 @@
+#ifndef RENDER_RING_H
+#define RENDER_RING_H
+
+// ----------------------------------------------------------------------------------------------------
+
+#include <atomic>
+#include <deque>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+
+// ----------------------------------------------------------------------------------------------------
+
+// shared memory ring used to send commands to a renderer running in another process (linux only)
+// the client process calls create() and passes get_fd() to the host process, which calls open()
+class RENDER_RING
+{
+public:
+	RENDER_RING() {}
+	~RENDER_RING();
+
+	RENDER_RING(const RENDER_RING&) = delete;
+	RENDER_RING& operator=(const RENDER_RING&) = delete;
+
+	// client process functions
+	bool create(size_t capacity, size_t upload_capacity);
+	void* begin_write(size_t size);
+	void end_write();
+	void* alloc_upload(size_t size, int32_t frame_index);
+
+	// host process functions, begin_read() returns nullptr for records a misbehaving client has corrupted
+	bool open(int fd);
+	const void* begin_read(size_t& size);
+	void end_read();
+	void set_executed_frame_index(int32_t frame_index);
+
+	// shared functions
+	void close();
+	int get_fd() const { return m_fd; }
+	size_t get_capacity() const { return (size_t)m_capacity; }
+	size_t get_upload_capacity() const { return (size_t)m_upload_capacity; }
+	bool is_open() const { return m_header != nullptr; }
+	bool is_peer_alive() const;
+	int32_t get_executed_frame_index() const;
+
+	bool is_upload(const void* ptr) const { return m_upload && (const uint8_t*)ptr >= m_upload && (const uint8_t*)ptr < m_upload + m_upload_capacity; }
+	uint64_t get_upload_offset(const void* ptr) const { return (uint64_t)((const uint8_t*)ptr - m_upload); }
+	const void* get_upload_ptr(uint64_t offset) const { return m_upload + offset; }
+
+private:
+	struct HEADER;
+
+	bool map(int fd, size_t size);
+	bool wait_for_space(uint64_t size);
+
+	int m_fd = -1;
+	size_t m_size = 0;
+	HEADER* m_header = nullptr;
+	uint8_t* m_data = nullptr;
+	uint64_t m_capacity = 0;
+	uint8_t* m_upload = nullptr;
+	uint64_t m_upload_capacity = 0;
+	bool m_host = false;
+
+	// writer / reader state, each only touched by one side
+	uint64_t m_write_pos = 0;
+	uint64_t m_write_size = 0;
+	uint64_t m_read_pos = 0;
+	uint64_t m_read_size = 0;
+
+	// upload heap state, client side only
+	uint64_t m_upload_head = 0;
+	uint64_t m_upload_tail = 0;
+	std::deque<std::pair<int32_t, uint64_t>> m_upload_frames;
+};
+
+#endif
@@ -1,6 +1,40 @@
 // ----------------------------------------------------------------------------------------------------
 
 #include <string>
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <pthread.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define RENDERER_SIMD_X64
+#if defined(_MSC_VER) && !defined(__clang__)
+#define RENDERER_TARGET_AVX2
+#else
+#define RENDERER_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
 
 #define SOKOL_IMPL
 #define SOKOL_GFX_IMPL
@@ -8,674 +42,4149 @@
 #undef SOKOL_GFX_IMPL
 
 #include "renderer.h"
+#include "render_ring.h"
+#include "texture_prep.h"
 
 // ----------------------------------------------------------------------------------------------------
 
 constexpr int32_t INITIAL_NUMBER_OF_COMMANDS = 512;
 constexpr int32_t INITIAL_NUMBER_OF_CLEANUPS = 128;
+constexpr size_t MAX_RING_PACKET_SIZE = 1024 * 1024;
+constexpr uint32_t MAX_MANIFEST_ENTRY_SIZE = 64 * 1024 * 1024;
+constexpr size_t CULL_BATCH_SIZE = 2048;
+constexpr double RESOLUTION_SMOOTHING = 0.2;
 
 // ----------------------------------------------------------------------------------------------------
 
-RENDERER::RENDERER(const sg_desc& desc)
+struct RING_PACKET
 {
-	// setup sokol graphics
-	sg_setup(desc);
-
-	// loop through commands
-	for (int32_t i = 0; i < 2; i ++)
+	// types
+	struct FLAGS
 	{
-		// reserve commands
-		m_commands[i].reserve(INITIAL_NUMBER_OF_COMMANDS);
-	}
+		enum ENUM
+		{
+			END_OF_FRAME = 1,
+			FLUSH = 2
+		};
+	};
 
-	// reserve cleamups
-	m_cleanups.reserve(INITIAL_NUMBER_OF_CLEANUPS);
-	
-	// release render semaphore
-	m_render_semaphore.release();
-}
+	uint32_t number_of_commands;
+	int32_t frame_index;
+	uint32_t flags;
+	uint32_t padding;
+};
 
 // ----------------------------------------------------------------------------------------------------
 
-RENDERER::~RENDERER()
-{
-	// process cleanups
-	process_cleanups(-1);
-	
-	// shutdown sokol graphics
-	sg_shutdown();
-}
+// pointers in commands sent through the ring are offsets from the packet start, or from the upload heap start
+constexpr uint64_t RING_UPLOAD_POINTER = 1ull << 63;
 
 // ----------------------------------------------------------------------------------------------------
 
-void RENDERER::execute_commands(bool resource_only)
+template <typename F> static void visit_image_data_pointers(sg_image_data& data, F&& fn)
 {
-	// not flushing?
-	if (!m_flushing)
-	{
-		// acquire update semaphore
-		m_update_semaphore.acquire();
-	}
-	
+	// loop through subimages
+	for (auto& face : data.subimage)
 	{
-		// lock execute mutex
-		std::scoped_lock<std::mutex> lock(m_execute_mutex);
-
-		// loop through commands
-		for (const auto& command : m_commands[m_commit_commands_index])
+		for (auto& subimage : face)
 		{
-			// ignore command?
-			if (resource_only && !(command.type >= RENDER_COMMAND::TYPE::MAKE_BUFFER && command.type <= RENDER_COMMAND::TYPE::DESTROY_PASS))
-			{
-				continue;
-			}
-
-			// execute command
-			switch (command.type)
-			{
-			case RENDER_COMMAND::TYPE::PUSH_DEBUG_GROUP:
-				sg_push_debug_group(command.push_debug_group.name);
-				break;
-			case RENDER_COMMAND::TYPE::POP_DEBUG_GROUP:
-				sg_pop_debug_group();
-				break;
-			case RENDER_COMMAND::TYPE::MAKE_BUFFER:
-				sg_init_buffer(command.make_buffer.buffer, command.make_buffer.desc);
-				break;
-			case RENDER_COMMAND::TYPE::MAKE_IMAGE:
-				sg_init_image(command.make_image.image, command.make_image.desc);
-				break;
-			case RENDER_COMMAND::TYPE::MAKE_SHADER:
-				sg_init_shader(command.make_shader.shader, command.make_shader.desc);
-				break;
-			case RENDER_COMMAND::TYPE::MAKE_PIPELINE:
-				sg_init_pipeline(command.make_pipeline.pipeline, command.make_pipeline.desc);
-				break;
-			case RENDER_COMMAND::TYPE::MAKE_PASS:
-				sg_init_pass(command.make_pass.pass, command.make_pass.desc);
-				break;
-			case RENDER_COMMAND::TYPE::DESTROY_BUFFER:
-				sg_uninit_buffer(command.destroy_buffer.buffer);
-				break;
-			case RENDER_COMMAND::TYPE::DESTROY_IMAGE:
-				sg_uninit_image(command.destroy_image.image);
-				break;
-			case RENDER_COMMAND::TYPE::DESTROY_SHADER:
-				sg_uninit_shader(command.destroy_shader.shader);
-				break;
-			case RENDER_COMMAND::TYPE::DESTROY_PIPELINE:
-				sg_uninit_pipeline(command.destroy_pipeline.pipeline);
-				break;
-			case RENDER_COMMAND::TYPE::DESTROY_PASS:
-				sg_uninit_pass(command.destroy_pass.pass);
-				break;
-			case RENDER_COMMAND::TYPE::UPDATE_BUFFER:
-				sg_update_buffer(command.update_buffer.buffer, command.update_buffer.data);
-				break;
-			case RENDER_COMMAND::TYPE::APPEND_BUFFER:
-				sg_append_buffer(command.append_buffer.buffer, command.append_buffer.data);
-				break;
-			case RENDER_COMMAND::TYPE::UPDATE_IMAGE:
-				sg_update_image(command.update_image.image, command.update_image.data);
-				break;
-			case RENDER_COMMAND::TYPE::BEGIN_DEFAULT_PASS:
-				sg_begin_default_pass(command.begin_default_pass.pass_action, m_default_pass_width, m_default_pass_height);
-				break;
-			case RENDER_COMMAND::TYPE::BEGIN_PASS:
-				sg_begin_pass(command.begin_pass.pass, command.begin_pass.pass_action);
-				break;
-			case RENDER_COMMAND::TYPE::APPLY_VIEWPORT:
-				sg_apply_viewport(command.apply_viewport.x, command.apply_viewport.y, command.apply_viewport.width, command.apply_viewport.height, command.apply_viewport.origin_top_left);
-				break;
-			case RENDER_COMMAND::TYPE::APPLY_SCISSOR_RECT:
-				sg_apply_scissor_rect(command.apply_scissor_rect.x, command.apply_scissor_rect.y, command.apply_scissor_rect.width, command.apply_scissor_rect.height, command.apply_scissor_rect.origin_top_left);
-				break;
-			case RENDER_COMMAND::TYPE::APPLY_PIPELINE:
-				sg_apply_pipeline(command.apply_pipeline.pipeline);
-				break;
-			case RENDER_COMMAND::TYPE::APPLY_BINDINGS:
-				sg_apply_bindings(command.apply_bindings.bindings);
-				break;
-			case RENDER_COMMAND::TYPE::APPLY_UNIFORMS:
-				sg_apply_uniforms(command.apply_uniforms.stage, command.apply_uniforms.ub_index, { command.apply_uniforms.buf, command.apply_uniforms.data_size });
-				break;
-			case RENDER_COMMAND::TYPE::DRAW:
-				sg_draw(command.draw.base_element, command.draw.number_of_elements, command.draw.number_of_instances);
-				break;
-			case RENDER_COMMAND::TYPE::END_PASS:
-				sg_end_pass();
-				break;
-			case RENDER_COMMAND::TYPE::COMMIT:
-				sg_commit();
-				break;
-			case RENDER_COMMAND::TYPE::CUSTOM:
-				command.custom.custom_cb(command.custom.custom_data);
-				break;
-			case RENDER_COMMAND::TYPE::NOT_SET:
-				break;
-			}
+			fn(subimage.ptr, subimage.size);
 		}
 	}
-
-	// release render semaphore
-	m_render_semaphore.release();
 }
 
 // ----------------------------------------------------------------------------------------------------
 
-void RENDERER::wait_for_flush()
+template <typename F> static void visit_shader_stage_pointers(sg_shader_stage_desc& stage, F&& fn)
 {
-	// initialise finished flushing
-	bool finished_flushing = false;
+	// visit stage pointers
+	fn(stage.source, SIZE_MAX);
+	fn(stage.bytecode.ptr, stage.bytecode.size);
+	fn(stage.entry, SIZE_MAX);
+	fn(stage.d3d11_target, SIZE_MAX);
 
-	// wait for flush
-	while (!finished_flushing)
+	// loop through uniform blocks
+	for (auto& uniform_block : stage.uniform_blocks)
 	{
-		// not flushing?
-		if (!m_flushing)
-		{
-			// acquire update semaphore
-			m_update_semaphore.acquire();
-		}
-		
+		for (auto& uniform : uniform_block.uniforms)
 		{
-			// lock execute mutex
-			std::scoped_lock<std::mutex> lock(m_execute_mutex);
-			
-			// loop through commands
-			for (const auto& command : m_commands[m_commit_commands_index])
-			{
-				// execute command
-				switch (command.type)
-				{
-				case RENDER_COMMAND::TYPE::MAKE_BUFFER:
-					sg_init_buffer(command.make_buffer.buffer, command.make_buffer.desc);
-					break;
-				case RENDER_COMMAND::TYPE::MAKE_IMAGE:
-					sg_init_image(command.make_image.image, command.make_image.desc);
-					break;
-				case RENDER_COMMAND::TYPE::MAKE_SHADER:
-					sg_init_shader(command.make_shader.shader, command.make_shader.desc);
-					break;
-				case RENDER_COMMAND::TYPE::MAKE_PIPELINE:
-					sg_init_pipeline(command.make_pipeline.pipeline, command.make_pipeline.desc);
-					break;
-				case RENDER_COMMAND::TYPE::MAKE_PASS:
-					sg_init_pass(command.make_pass.pass, command.make_pass.desc);
-					break;
-				case RENDER_COMMAND::TYPE::DESTROY_BUFFER:
-					sg_uninit_buffer(command.destroy_buffer.buffer);
-					break;
-				case RENDER_COMMAND::TYPE::DESTROY_IMAGE:
-					sg_uninit_image(command.destroy_image.image);
-					break;
-				case RENDER_COMMAND::TYPE::DESTROY_SHADER:
-					sg_uninit_shader(command.destroy_shader.shader);
-					break;
-				case RENDER_COMMAND::TYPE::DESTROY_PIPELINE:
-					sg_uninit_pipeline(command.destroy_pipeline.pipeline);
-					break;
-				case RENDER_COMMAND::TYPE::DESTROY_PASS:
-					sg_uninit_pass(command.destroy_pass.pass);
-					break;
-				default:
-					break;
-				}
-			}
+			fn(uniform.name, SIZE_MAX);
 		}
-		
-		// udpate finished flushing
-		finished_flushing = m_flushing;
+	}
 
-		// release render semaphore
-		m_render_semaphore.release();
+	// loop through images
+	for (auto& image : stage.images)
+	{
+		fn(image.name, SIZE_MAX);
 	}
 }
 
 // ----------------------------------------------------------------------------------------------------
 
-void RENDERER::add_command_push_debug_group(const char* name)
+// calls fn(ptr, size) for every pointer a command references, size is SIZE_MAX for strings
+template <typename F> static void visit_command_pointers(RENDER_COMMAND& command, F&& fn)
 {
-	// add command
-	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::PUSH_DEBUG_GROUP);
-
-	// copy args
-	command.push_debug_group.name = name;
+	switch (command.type)
+	{
+	case RENDER_COMMAND::TYPE::PUSH_DEBUG_GROUP:
+		fn(command.push_debug_group.name, SIZE_MAX);
+		break;
+	case RENDER_COMMAND::TYPE::MAKE_BUFFER:
+		fn(command.make_buffer.desc.data.ptr, command.make_buffer.desc.data.size);
+		fn(command.make_buffer.desc.label, SIZE_MAX);
+		break;
+	case RENDER_COMMAND::TYPE::MAKE_IMAGE:
+		visit_image_data_pointers(command.make_image.desc.data, fn);
+		fn(command.make_image.desc.label, SIZE_MAX);
+		break;
+	case RENDER_COMMAND::TYPE::MAKE_SHADER:
+		for (auto& attr : command.make_shader.desc.attrs)
+		{
+			fn(attr.name, SIZE_MAX);
+			fn(attr.sem_name, SIZE_MAX);
+		}
+		visit_shader_stage_pointers(command.make_shader.desc.vs, fn);
+		visit_shader_stage_pointers(command.make_shader.desc.fs, fn);
+		fn(command.make_shader.desc.label, SIZE_MAX);
+		break;
+	case RENDER_COMMAND::TYPE::MAKE_PIPELINE:
+		fn(command.make_pipeline.desc.label, SIZE_MAX);
+		break;
+	case RENDER_COMMAND::TYPE::MAKE_PASS:
+		fn(command.make_pass.desc.label, SIZE_MAX);
+		break;
+	case RENDER_COMMAND::TYPE::UPDATE_BUFFER:
+		fn(command.update_buffer.data.ptr, command.update_buffer.data.size);
+		break;
+	case RENDER_COMMAND::TYPE::APPEND_BUFFER:
+		fn(command.append_buffer.data.ptr, command.append_buffer.data.size);
+		break;
+	case RENDER_COMMAND::TYPE::UPDATE_IMAGE:
+		visit_image_data_pointers(command.update_image.data, fn);
+		break;
+	default:
+		break;
+	}
 }
 
 // ----------------------------------------------------------------------------------------------------
 
-void RENDERER::add_command_pop_debug_group()
+static size_t get_ring_payload_size(const void* ptr, size_t size)
 {
-	// add command
-	/*RENDER_COMMAND& command = */m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::POP_DEBUG_GROUP);
+	// strings include terminator, payloads are kept 16 byte aligned
+	return ((size == SIZE_MAX ? strlen((const char*)ptr) + 1 : size) + 15) & ~(size_t)15;
 }
 
 // ----------------------------------------------------------------------------------------------------
 
-sg_buffer RENDERER::add_command_make_buffer(const sg_buffer_desc& desc)
+static void clear_native_resources(RENDER_COMMAND& command)
 {
-	// add command
-	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::MAKE_BUFFER);
+	// buffer?
+	if (command.type == RENDER_COMMAND::TYPE::MAKE_BUFFER)
+	{
+		sg_buffer_desc& desc = command.make_buffer.desc;
+		memset(desc.gl_buffers, 0, sizeof(desc.gl_buffers));
+		memset((void*)desc.mtl_buffers, 0, sizeof(desc.mtl_buffers));
+		desc.d3d11_buffer = nullptr;
+		desc.wgpu_buffer = nullptr;
+	}
 
-	// copy args
-	command.make_buffer.desc = desc;
-	
-	// alloc buffer
-	command.make_buffer.buffer = sg_alloc_buffer();
-	
-	// return buffer
-	return command.make_buffer.buffer;
+	// image?
+	else if (command.type == RENDER_COMMAND::TYPE::MAKE_IMAGE)
+	{
+		sg_image_desc& desc = command.make_image.desc;
+		memset(desc.gl_textures, 0, sizeof(desc.gl_textures));
+		memset((void*)desc.mtl_textures, 0, sizeof(desc.mtl_textures));
+		desc.d3d11_texture = nullptr;
+		desc.d3d11_shader_resource_view = nullptr;
+		desc.wgpu_texture = nullptr;
+	}
 }
 
 // ----------------------------------------------------------------------------------------------------
 
-sg_image RENDERER::add_command_make_image(const sg_image_desc& desc)
-{
-	// add command
-	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::MAKE_IMAGE);
+// pipeline manifest file layout, descs are stored as raw structs so a manifest is only valid for the sokol build that wrote it
+constexpr uint32_t MANIFEST_MAGIC = 0x4d504753;
+constexpr uint32_t MANIFEST_VERSION = 1;
 
-	// copy args
-	command.make_image.desc = desc;
+// ----------------------------------------------------------------------------------------------------
 
-	// alloc image
-	command.make_image.image = sg_alloc_image();
-	
-	// return image
-	return command.make_image.image;
-}
+struct MANIFEST_HEADER
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t shader_desc_size;
+	uint32_t pipeline_desc_size;
+	uint32_t number_of_entries;
+	uint32_t padding;
+};
 
 // ----------------------------------------------------------------------------------------------------
 
-sg_shader RENDERER::add_command_make_shader(const sg_shader_desc& desc)
+struct MANIFEST_ENTRY_HEADER
 {
-	// add command
-	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::MAKE_SHADER);
+	uint32_t type;
+	uint32_t size;
+	uint64_t hash;
+	uint64_t shader_hash;
+};
 
-	// copy args
-	command.make_shader.desc = desc;
+// ----------------------------------------------------------------------------------------------------
 
-	// alloc shader
-	command.make_shader.shader = sg_alloc_shader();
-	
-	// return shader
-	return command.make_shader.shader;
+static uint64_t hash_bytes(const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325ull)
+{
+	// fnv-1a
+	for (size_t i = 0; i < size; i ++)
+	{
+		hash ^= ((const uint8_t*)data)[i];
+		hash *= 0x100000001b3ull;
+	}
+
+	// return hash
+	return hash;
 }
 
 // ----------------------------------------------------------------------------------------------------
 
-sg_pipeline RENDERER::add_command_make_pipeline(const sg_pipeline_desc& desc)
+static void clear_manifest_command(RENDER_COMMAND& command, RENDER_COMMAND::TYPE::ENUM type)
 {
-	// add command
-	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::MAKE_PIPELINE);
-
-	// copy args
-	command.make_pipeline.desc = desc;
-
-	// alloc pipeline
-	command.make_pipeline.pipeline = sg_alloc_pipeline();
-	
-	// return pipeline
-	return command.make_pipeline.pipeline;
+	// descs are hashed as raw bytes, so padding that copying a desc skips must be zero rather than whatever was on the stack
+	memset((void*)&command, 0, sizeof(RENDER_COMMAND));
+	command.type = type;
 }
 
 // ----------------------------------------------------------------------------------------------------
 
-sg_pass RENDERER::add_command_make_pass(const sg_pass_desc& desc)
+static void* get_manifest_desc(RENDER_COMMAND& command, size_t& size)
 {
-	// add command
-	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::MAKE_PASS);
-
-	// copy args
-	command.make_pass.desc = desc;
+	// shader?
+	if (command.type == RENDER_COMMAND::TYPE::MAKE_SHADER)
+	{
+		size = sizeof(sg_shader_desc);
+		return &command.make_shader.desc;
+	}
 
-	// alloc pass
-	command.make_pass.pass = sg_alloc_pass();
-	
-	// return pass
-	return command.make_pass.pass;
+	// pipeline
+	size = sizeof(sg_pipeline_desc);
+	return &command.make_pipeline.desc;
 }
 
 // ----------------------------------------------------------------------------------------------------
 
-void RENDERER::add_command_destroy_buffer(sg_buffer buffer)
+static void serialize_manifest_desc(RENDER_COMMAND& command, std::vector<uint8_t>& data)
 {
-	// add command
-	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::DESTROY_BUFFER);
+	// get desc
+	size_t desc_size = 0;
+	void* desc = get_manifest_desc(command, desc_size);
 
-	// copy args
-	command.destroy_buffer.buffer = buffer;
+	// reserve space for desc, payloads follow it
+	data.assign((desc_size + 15) & ~(size_t)15, 0);
 
-	// schedule cleanup
-	schedule_cleanup(dealloc_buffer_cb, (void*)(uintptr_t)command.destroy_buffer.buffer.id);
+	// loop through pointers
+	visit_command_pointers(command, [&](auto& ptr, size_t size)
+	{
+		if (ptr)
+		{
+			// copy payload
+			size_t offset = data.size();
+			data.resize(offset + get_ring_payload_size(ptr, size), 0);
+			memcpy(data.data() + offset, ptr, size == SIZE_MAX ? strlen((const char*)ptr) + 1 : size);
+
+			// replace pointer with offset
+			ptr = (std::remove_reference_t<decltype(ptr)>)(uintptr_t)offset;
+		}
+	});
+
+	// copy desc
+	memcpy(data.data(), desc, desc_size);
 }
 
 // ----------------------------------------------------------------------------------------------------
 
-void RENDERER::add_command_destroy_image(sg_image image)
+static bool deserialize_manifest_desc(RENDER_COMMAND& command, std::vector<uint8_t>& data)
 {
-	// add command
-	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::DESTROY_IMAGE);
+	// get desc
+	size_t desc_size = 0;
+	void* desc = get_manifest_desc(command, desc_size);
 
-	// copy args
-	command.destroy_image.image = image;
+	// truncated?
+	if (data.size() < desc_size)
+	{
+		return false;
+	}
 
-	// schedule cleanup
-	schedule_cleanup(dealloc_image_cb, (void*)(uintptr_t)command.destroy_image.image.id);
-}
+	// copy desc
+	memcpy(desc, data.data(), desc_size);
 
-// ----------------------------------------------------------------------------------------------------
+	// turn offsets back into pointers
+	bool valid = true;
+	visit_command_pointers(command, [&](auto& ptr, size_t size)
+	{
+		uint64_t offset = (uint64_t)(uintptr_t)ptr;
+		if (offset)
+		{
+			// out of range or unterminated string?
+			if (offset < desc_size || offset > data.size() || (size == SIZE_MAX ? !memchr(data.data() + offset, 0, data.size() - offset) : size > data.size() - offset))
+			{
+				ptr = nullptr;
+				valid = false;
+				return;
+			}
 
-void RENDERER::add_command_destroy_shader(sg_shader shader)
-{
-	// add command
-	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::DESTROY_SHADER);
+			// fix up pointer
+			ptr = (std::remove_reference_t<decltype(ptr)>)(data.data() + offset);
+		}
+	});
 
-	// copy args
-	command.destroy_shader.shader = shader;
+	// copy fixed up desc back, it stays valid for as long as the data isn't reallocated
+	memcpy(data.data(), desc, desc_size);
 
-	// schedule cleanup
-	schedule_cleanup(dealloc_shader_cb, (void*)(uintptr_t)command.destroy_shader.shader.id);
+	// return whether valid
+	return valid;
 }
 
 // ----------------------------------------------------------------------------------------------------
 
-void RENDERER::add_command_destroy_pipeline(sg_pipeline pipeline)
+struct CULL_INPUT
 {
-	// add command
-	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::DESTROY_PIPELINE);
+	const float* planes;
+	const float* abs_normals;
+	const float* center_x;
+	const float* center_y;
+	const float* center_z;
+	const float* extents_x;
+	const float* extents_y;
+	const float* extents_z;
+	const float* radius;
+	uint8_t* visible;
+};
 
-	// copy args
-	command.destroy_pipeline.pipeline = pipeline;
+// ----------------------------------------------------------------------------------------------------
 
-	// schedule cleanup
-	schedule_cleanup(dealloc_pipeline_cb, (void*)(uintptr_t)command.destroy_pipeline.pipeline.id);
+static void cull_scalar(const CULL_INPUT& input, size_t begin, size_t end)
+{
+	// loop through bounds
+	for (size_t i = begin; i < end; i ++)
+	{
+		// loop through planes until outside one
+		bool visible = true;
+		for (int32_t p = 0; p < 6 && visible; p ++)
+		{
+			const float* plane = input.planes + p * 4;
+			const float* abs_normal = input.abs_normals + p * 3;
+			float distance = plane[0] * input.center_x[i] + plane[1] * input.center_y[i] + plane[2] * input.center_z[i] + plane[3];
+			float extent = input.radius[i] + abs_normal[0] * input.extents_x[i] + abs_normal[1] * input.extents_y[i] + abs_normal[2] * input.extents_z[i];
+			visible = !(distance + extent < 0.0f);
+		}
+
+		// set visible
+		input.visible[i] = visible;
+	}
 }
 
 // ----------------------------------------------------------------------------------------------------
 
-void RENDERER::add_command_destroy_pass(sg_pass pass)
+#if defined(RENDERER_SIMD_X64)
+
+static size_t cull_sse(const CULL_INPUT& input, size_t begin, size_t end)
 {
-	// add command
-	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::DESTROY_PASS);
+	// loop through groups of 4 bounds
+	size_t i = begin;
+	for (; i + 4 <= end; i += 4)
+	{
+		// load bounds
+		__m128 center_x = _mm_loadu_ps(input.center_x + i);
+		__m128 center_y = _mm_loadu_ps(input.center_y + i);
+		__m128 center_z = _mm_loadu_ps(input.center_z + i);
+		__m128 extents_x = _mm_loadu_ps(input.extents_x + i);
+		__m128 extents_y = _mm_loadu_ps(input.extents_y + i);
+		__m128 extents_z = _mm_loadu_ps(input.extents_z + i);
+		__m128 radius = _mm_loadu_ps(input.radius + i);
 
-	// copy args
+		// loop through planes
+		__m128 outside = _mm_setzero_ps();
+		for (int32_t p = 0; p < 6; p ++)
+		{
+			const float* plane = input.planes + p * 4;
+			const float* abs_normal = input.abs_normals + p * 3;
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[0]), center_x), _mm_mul_ps(_mm_set1_ps(plane[1]), center_y)), _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[2]), center_z), _mm_set1_ps(plane[3])));
+			__m128 extent = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(abs_normal[0]), extents_x), _mm_mul_ps(_mm_set1_ps(abs_normal[1]), extents_y)), _mm_add_ps(_mm_mul_ps(_mm_set1_ps(abs_normal[2]), extents_z), radius));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, extent), _mm_setzero_ps()));
+		}
+
+		// set visible
+		int mask = _mm_movemask_ps(outside);
+		for (int32_t j = 0; j < 4; j ++)
+		{
+			input.visible[i + j] = !((mask >> j) & 1);
+		}
+	}
+
+	// return first bounds not tested
+	return i;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+RENDERER_TARGET_AVX2 static size_t cull_avx2(const CULL_INPUT& input, size_t begin, size_t end)
+{
+	// loop through groups of 8 bounds
+	size_t i = begin;
+	for (; i + 8 <= end; i += 8)
+	{
+		// load bounds
+		__m256 center_x = _mm256_loadu_ps(input.center_x + i);
+		__m256 center_y = _mm256_loadu_ps(input.center_y + i);
+		__m256 center_z = _mm256_loadu_ps(input.center_z + i);
+		__m256 extents_x = _mm256_loadu_ps(input.extents_x + i);
+		__m256 extents_y = _mm256_loadu_ps(input.extents_y + i);
+		__m256 extents_z = _mm256_loadu_ps(input.extents_z + i);
+		__m256 radius = _mm256_loadu_ps(input.radius + i);
+
+		// loop through planes
+		__m256 outside = _mm256_setzero_ps();
+		for (int32_t p = 0; p < 6; p ++)
+		{
+			const float* plane = input.planes + p * 4;
+			const float* abs_normal = input.abs_normals + p * 3;
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane[0]), center_x), _mm256_mul_ps(_mm256_set1_ps(plane[1]), center_y)), _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane[2]), center_z), _mm256_set1_ps(plane[3])));
+			__m256 extent = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(abs_normal[0]), extents_x), _mm256_mul_ps(_mm256_set1_ps(abs_normal[1]), extents_y)), _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(abs_normal[2]), extents_z), radius));
+			outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, extent), _mm256_setzero_ps(), _CMP_LT_OQ));
+		}
+
+		// set visible
+		int mask = _mm256_movemask_ps(outside);
+		for (int32_t j = 0; j < 8; j ++)
+		{
+			input.visible[i + j] = !((mask >> j) & 1);
+		}
+	}
+
+	// return first bounds not tested
+	return i;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+static bool has_avx2()
+{
+#if defined(_WIN32)
+#if defined(PF_AVX2_INSTRUCTIONS_AVAILABLE)
+	return IsProcessorFeaturePresent(PF_AVX2_INSTRUCTIONS_AVAILABLE);
+#else
+	return false;
+#endif
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+// ----------------------------------------------------------------------------------------------------
+
+static void apply_render_thread_settings(const RENDER_THREAD_DESC& desc)
+{
+#if defined(_WIN32)
+	// set affinity
+	DWORD_PTR mask = 0;
+	for (int32_t cpu : desc.cpus)
+	{
+		if (cpu >= 0 && cpu < (int32_t)(sizeof(DWORD_PTR) * 8))
+		{
+			mask |= (DWORD_PTR)1 << cpu;
+		}
+	}
+	if (mask)
+	{
+		SetThreadAffinityMask(GetCurrentThread(), mask);
+	}
+
+	// set priority
+	switch (desc.priority)
+	{
+	case RENDER_THREAD_DESC::PRIORITY::LOW:
+		SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+		break;
+	case RENDER_THREAD_DESC::PRIORITY::HIGH:
+		SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_ABOVE_NORMAL);
+		break;
+	case RENDER_THREAD_DESC::PRIORITY::HIGHEST:
+		SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+		break;
+	default:
+		break;
+	}
+#elif defined(__APPLE__)
+	// no affinity on macos/ios, use quality of service classes for priority
+	switch (desc.priority)
+	{
+	case RENDER_THREAD_DESC::PRIORITY::LOW:
+		pthread_set_qos_class_self_np(QOS_CLASS_UTILITY, 0);
+		break;
+	case RENDER_THREAD_DESC::PRIORITY::HIGH:
+	case RENDER_THREAD_DESC::PRIORITY::HIGHEST:
+		pthread_set_qos_class_self_np(QOS_CLASS_USER_INTERACTIVE, 0);
+		break;
+	default:
+		break;
+	}
+#else
+	// set affinity
+	if (!desc.cpus.empty())
+	{
+		cpu_set_t cpu_set;
+		CPU_ZERO(&cpu_set);
+		for (int32_t cpu : desc.cpus)
+		{
+			if (cpu >= 0 && cpu < CPU_SETSIZE)
+			{
+				CPU_SET(cpu, &cpu_set);
+			}
+		}
+		pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+	}
+
+	// set priority, failures (e.g. missing CAP_SYS_NICE) leave the thread at normal priority
+	// realtime scheduling isn't used, a SCHED_FIFO thread spinning on yield() would starve an update thread sharing its cpu
+	pid_t tid = (pid_t)syscall(SYS_gettid);
+	switch (desc.priority)
+	{
+	case RENDER_THREAD_DESC::PRIORITY::LOW:
+		setpriority(PRIO_PROCESS, tid, 5);
+		break;
+	case RENDER_THREAD_DESC::PRIORITY::HIGH:
+		setpriority(PRIO_PROCESS, tid, -5);
+		break;
+	case RENDER_THREAD_DESC::PRIORITY::HIGHEST:
+		setpriority(PRIO_PROCESS, tid, -10);
+		break;
+	default:
+		break;
+	}
+#endif
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+RENDERER::RENDERER(const sg_desc& desc, bool setup_on_render_thread) : m_desc(desc), m_setup_on_render_thread(setup_on_render_thread)
+{
+	// setup sokol graphics, unless the render thread does it before executing the first frame
+	if (!setup_on_render_thread)
+	{
+		sg_setup(desc);
+		m_setup_complete = true;
+	}
+
+	// loop through commands
+	for (int32_t i = 0; i < 2; i ++)
+	{
+		// reserve commands
+		m_commands[i].reserve(INITIAL_NUMBER_OF_COMMANDS);
+	}
+
+	// reserve cleamups
+	m_cleanups.reserve(INITIAL_NUMBER_OF_CLEANUPS);
+	
+	// release render semaphore
+	m_render_semaphore.release();
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+RENDERER::RENDERER(RENDER_RING* ring) : m_ring(ring)
+{
+	// reserve commands, sokol graphics lives in the host process so isn't setup here
+	m_commands[m_pending_commands_index].reserve(INITIAL_NUMBER_OF_COMMANDS);
+
+	// reserve cleamups
+	m_cleanups.reserve(INITIAL_NUMBER_OF_CLEANUPS);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+RENDERER::~RENDERER()
+{
+	// stop render thread
+	stop_render_thread();
+
+	// finish image jobs, their commands will never be added
+	destroy_texture_jobs();
+
+	// destroy closures that were never executed
+	destroy_closures(m_commands[0]);
+	destroy_closures(m_commands[1]);
+	for (auto& chunk : m_partial_chunks)
+	{
+		destroy_closures(chunk);
+	}
+
+	// remote?
+	if (m_ring)
+	{
+		// wait for host to execute the flush, unless it has gone away
+		while (m_flushing && m_ring->get_executed_frame_index() < m_frame_index && m_ring->is_peer_alive())
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		// process cleanups
+		process_cleanups(-1);
+
+		// stop cleanup thread, once it has drained
+		stop_cleanup_thread();
+
+		// delete trace
+		delete m_trace.load();
+		return;
+	}
+
+	// fast teardown, or sokol graphics shutdown on the render thread or never setup? every handle is already released so the deallocations are dropped
+	if (m_fast_teardown.load(std::memory_order_relaxed) || m_shutdown_complete.load(std::memory_order_acquire) || !m_setup_complete.load(std::memory_order_acquire))
+	{
+		m_cleanups.erase(std::remove_if(m_cleanups.begin(), m_cleanups.end(), [](const auto& cleanup) { return cleanup.synchronous; }), m_cleanups.end());
+	}
+
+	// process cleanups, handed to the cleanup executor as one batch if there is one
+	process_cleanups(-1);
+
+	// stop cleanup thread, once it has drained
+	stop_cleanup_thread();
+	
+	// shutdown sokol graphics, unless it was never setup or the render thread already shut it down
+	if (m_setup_complete.load(std::memory_order_acquire) && !m_shutdown_complete.load(std::memory_order_acquire))
+	{
+		sg_shutdown();
+	}
+
+	// delete trace
+	delete m_trace.load();
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::execute_commands(bool resource_only)
+{
+	// setup sokol graphics
+	complete_setup();
+
+	// remember the render thread, it can't wait for its own fences
+	m_render_thread_id.store(std::this_thread::get_id(), std::memory_order_relaxed);
+
+	// not flushing?
+	if (!m_flushing)
+	{
+		// acquire update semaphore, building prewarmed shaders/pipelines until a commit is ready
+		trace_begin(TRACE::THREAD::RENDER, "wait_for_commit");
+		while (!m_update_semaphore.try_acquire())
+		{
+			if (!build_prewarm_entry())
+			{
+				m_update_semaphore.acquire();
+				break;
+			}
+		}
+		trace_end(TRACE::THREAD::RENDER);
+	}
+	
+	// execute frame
+	execute_frame(resource_only);
+	publish_executed_frame_index(m_commit_frame_index);
+
+	// release render semaphore
+	m_render_semaphore.release();
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::wait_for_flush()
+{
+	// setup sokol graphics
+	complete_setup();
+
+	// begin trace
+	trace_begin(TRACE::THREAD::RENDER, "wait_for_flush");
+
+	// initialise finished flushing
+	bool finished_flushing = false;
+
+	// wait for flush
+	while (!finished_flushing)
+	{
+		// not flushing?
+		if (!m_flushing)
+		{
+			// acquire update semaphore
+			m_update_semaphore.acquire();
+		}
+		
+		// execute resource commands
+		execute_frame(true);
+		publish_executed_frame_index(m_commit_frame_index);
+		
+		// udpate finished flushing
+		finished_flushing = m_flushing;
+		if (finished_flushing)
+		{
+			publish_teardown_time();
+		}
+
+		// release render semaphore
+		m_render_semaphore.release();
+	}
+
+	// shutdown sokol graphics, if this thread set it up
+	complete_shutdown();
+
+	// end trace
+	trace_end(TRACE::THREAD::RENDER);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::complete_setup()
+{
+	// already setup?
+	if (m_setup_complete.load(std::memory_order_relaxed))
+	{
+		return;
+	}
+
+	// lock out the update thread reserving handles
+	std::scoped_lock<std::mutex> lock(m_handle_mutex);
+
+	// setup sokol graphics
+	sg_setup(m_desc);
+
+	// alloc the reserved handles, a fresh pool hands them out in the order they were reserved so commands recorded with them need no translation
+	for (int32_t type = 0; type < RESOURCE_TYPE::COUNT; type ++)
+	{
+		for (uint32_t i = 0; i < m_number_of_reserved_handles[type]; i ++)
+		{
+			alloc_host_handle((RESOURCE_TYPE::ENUM)type);
+		}
+	}
+
+	// the update thread allocates sokol handles itself once it sees this
+	m_setup_complete.store(true, std::memory_order_release);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::complete_shutdown()
+{
+	// setup on the constructing thread or never setup? the destructor shuts it down
+	if (!m_setup_on_render_thread || !m_setup_complete.load(std::memory_order_relaxed) || m_shutdown_complete.load(std::memory_order_relaxed))
+	{
+		return;
+	}
+
+	// shutdown sokol graphics on the thread that set it up, while its context is still current
+	sg_shutdown();
+	m_shutdown_complete.store(true, std::memory_order_release);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::start_render_thread(const RENDER_THREAD_DESC& desc)
+{
+	// already started?
+	if (m_render_thread.joinable())
+	{
+		return;
+	}
+
+	// copy desc
+	m_render_thread_desc = desc;
+
+	// start render thread
+	m_render_thread = std::thread(&RENDERER::render_thread_loop, this);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::stop_render_thread()
+{
+	// not started?
+	if (!m_render_thread.joinable())
+	{
+		return;
+	}
+
+	// never flushed? the render thread only exits once it has executed a flush, so deleting the renderer would hang
+	if (!m_flushing)
+	{
+		flush_commands();
+	}
+
+	// wait for render thread to see the flush and exit
+	m_render_thread.join();
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+bool RENDERER::execute_ring_commands(RENDER_RING& ring)
+{
+	// setup sokol graphics
+	complete_setup();
+
+	// remember the render thread, it can't wait for its own fences
+	m_render_thread_id.store(std::this_thread::get_id(), std::memory_order_relaxed);
+
+	// initialise end of frame
+	bool end_of_frame = false;
+	bool flushing = false;
+
+	// loop through packets until the end of the frame
+	while (!end_of_frame)
+	{
+		// read packet
+		trace_begin(TRACE::THREAD::RENDER, "wait_for_commit");
+		size_t size = 0;
+		const uint8_t* data = (const uint8_t*)ring.begin_read(size);
+		trace_end(TRACE::THREAD::RENDER);
+
+		// client gone?
+		if (!data)
+		{
+			return false;
+		}
+
+		// copy packet header, the client can still write to shared memory so everything is copied before it's checked
+		RING_PACKET packet = {};
+		if (size >= sizeof(RING_PACKET))
+		{
+			memcpy(&packet, data, sizeof(RING_PACKET));
+		}
+
+		// invalid packet?
+		if (size < sizeof(RING_PACKET) || packet.number_of_commands > (size - sizeof(RING_PACKET)) / sizeof(RENDER_COMMAND))
+		{
+			ring.end_read();
+			return false;
+		}
+
+		// get flags
+		end_of_frame = packet.flags & RING_PACKET::FLAGS::END_OF_FRAME;
+		flushing = packet.flags & RING_PACKET::FLAGS::FLUSH;
+		if (flushing)
+		{
+			m_flushing = true;
+		}
+
+		// loop through packet commands
+		RENDER_COMMAND_ARRAY& commands = m_commands[m_commit_commands_index];
+		commands.resize(0);
+		m_ring_strings.clear();
+		const RENDER_COMMAND* packet_commands = (const RENDER_COMMAND*)(data + sizeof(RING_PACKET));
+		size_t payload_offset = sizeof(RING_PACKET) + packet.number_of_commands * sizeof(RENDER_COMMAND);
+		for (uint32_t i = 0; i < packet.number_of_commands; i ++)
+		{
+			// copy command
+			RENDER_COMMAND& command = commands.emplace_back();
+			memcpy((void*)&command, &packet_commands[i], sizeof(RENDER_COMMAND));
+
+			// turn offsets back into pointers, disconnecting a client that sent something the host can't safely execute
+			if (!read_ring_command(ring, command, data, size, payload_offset))
+			{
+				commands.resize(0);
+				ring.end_read();
+				return false;
+			}
+		}
+
+		// turn client handles into host handles, once the whole packet is known to be valid
+		for (RENDER_COMMAND& command : commands)
+		{
+			translate_ring_handles(command);
+		}
+
+		// execute frame, only resource commands once flushing
+		execute_frame(flushing);
+
+		// dealloc destroyed handles
+		dealloc_ring_handles();
+
+		// release packet
+		ring.end_read();
+
+		// publish executed frame
+		if (end_of_frame)
+		{
+			ring.set_executed_frame_index(packet.frame_index);
+			publish_executed_frame_index(packet.frame_index);
+		}
+	}
+
+	// return whether to keep going
+	return !flushing;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+int32_t RENDERER::get_executed_frame_index() const
+{
+	// remote? the host publishes it in the ring
+	if (m_ring)
+	{
+		return m_ring->get_executed_frame_index();
+	}
+
+	// return executed frame index
+	return m_executed_frame_index.load(std::memory_order_acquire);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+bool RENDERER::is_fence_complete(int32_t fence) const
+{
+	// executed?
+	return get_executed_frame_index() >= fence;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+bool RENDERER::wait_for_fence(int32_t fence)
+{
+	// already complete?
+	if (is_fence_complete(fence))
+	{
+		return true;
+	}
+
+	// called from the render thread, frame not committed, or nothing left to commit after a flush? the wait would never end
+	if (std::this_thread::get_id() == m_render_thread_id.load(std::memory_order_relaxed) || fence > m_frame_index || (fence == m_frame_index && !m_flushing))
+	{
+		return false;
+	}
+
+	// remote?
+	if (m_ring)
+	{
+		// poll ring, unless the host has gone away
+		while (!is_fence_complete(fence))
+		{
+			if (!m_ring->is_peer_alive())
+			{
+				return false;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return true;
+	}
+
+	// wait for render thread to publish the frame
+	m_number_of_fence_waiters ++;
+	{
+		std::unique_lock<std::mutex> lock(m_fence_mutex);
+		m_fence_cv.wait(lock, [&]() { return m_executed_frame_index.load() >= fence; });
+	}
+	m_number_of_fence_waiters --;
+	return true;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::cull_commands(bool end_of_frame)
+{
+	// begin trace
+	trace_begin(TRACE::THREAD::UPDATE, "cull_commands");
+	auto start_time = std::chrono::steady_clock::now();
+
+	// split bounds into batches
+	m_cull_jobs.resize(0);
+	for (int32_t f = 0; f < m_number_of_cull_frustums; f ++)
+	{
+		CULL_FRUSTUM& frustum = m_cull_frustums[f];
+		frustum.visible.resize(frustum.commands.size());
+		for (size_t begin = 0; begin < frustum.commands.size(); begin += CULL_BATCH_SIZE)
+		{
+			m_cull_jobs.emplace_back(f, begin);
+		}
+	}
+
+	// cull batches across the workers
+	m_worker_pool.parallel_for(m_cull_jobs.size(), [this](size_t index)
+	{
+		CULL_FRUSTUM& frustum = m_cull_frustums[m_cull_jobs[index].first];
+		size_t begin = m_cull_jobs[index].second;
+		cull_range(frustum, begin, std::min(begin + CULL_BATCH_SIZE, frustum.commands.size()));
+	});
+
+	// loop through frustums
+	RENDER_COMMAND_ARRAY& commands = m_commands[m_pending_commands_index];
+	for (int32_t f = 0; f < m_number_of_cull_frustums; f ++)
+	{
+		// remove culled draws
+		CULL_FRUSTUM& frustum = m_cull_frustums[f];
+		for (size_t i = 0; i < frustum.commands.size(); i ++)
+		{
+			if (!frustum.visible[i])
+			{
+				commands[frustum.commands[i]].type = RENDER_COMMAND::TYPE::NOT_SET;
+				m_frame_stats.number_of_culled_draws ++;
+			}
+		}
+		m_frame_stats.number_of_cull_tests += (uint32_t)frustum.commands.size();
+
+		// clear bounds
+		frustum.center_x.resize(0);
+		frustum.center_y.resize(0);
+		frustum.center_z.resize(0);
+		frustum.extents_x.resize(0);
+		frustum.extents_y.resize(0);
+		frustum.extents_z.resize(0);
+		frustum.radius.resize(0);
+		frustum.commands.resize(0);
+	}
+
+	// frustums only last until the end of the frame
+	if (end_of_frame)
+	{
+		m_number_of_cull_frustums = 0;
+	}
+
+	// end trace
+	m_frame_stats.cull_time += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+	trace_end(TRACE::THREAD::UPDATE);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::optimize_commands(RENDER_COMMAND_ARRAY& commands)
+{
+	// begin trace
+	trace_begin(TRACE::THREAD::UPDATE, "optimize_commands");
+
+	// optimize state?
+	if (m_optimize_commands)
+	{
+		// state applied since the last draw, commands that draw or may read it (custom commands) make it live
+		int32_t pipeline = -1;
+		int32_t bindings = -1;
+		int32_t uniforms[SG_NUM_SHADER_STAGES][SG_MAX_SHADERSTAGE_UBS];
+		int32_t viewport = -1;
+		int32_t scissor_rect = -1;
+		auto forget_state = [&]()
+		{
+			pipeline = bindings = viewport = scissor_rect = -1;
+			std::fill(&uniforms[0][0], &uniforms[0][0] + SG_NUM_SHADER_STAGES * SG_MAX_SHADERSTAGE_UBS, -1);
+		};
+		auto remove_state = [&](int32_t& index)
+		{
+			if (index >= 0)
+			{
+				commands[index].type = RENDER_COMMAND::TYPE::NOT_SET;
+				m_frame_stats.number_of_dead_state_commands ++;
+				index = -1;
+			}
+		};
+		auto remove_pipeline_state = [&]()
+		{
+			remove_state(pipeline);
+			remove_state(bindings);
+			for (auto& stage_uniforms : uniforms)
+			{
+				for (auto& index : stage_uniforms)
+				{
+					remove_state(index);
+				}
+			}
+		};
+		forget_state();
+
+		// current pass, which can be folded while it only contains state and balanced debug groups
+		int32_t pass = -1;
+		bool foldable = false;
+		int32_t pass_debug_depth = 0;
+
+		// loop through commands
+		for (int32_t i = 0; i < (int32_t)commands.size(); i ++)
+		{
+			RENDER_COMMAND& command = commands[i];
+			switch (command.type)
+			{
+			case RENDER_COMMAND::TYPE::NOT_SET:
+				break;
+			case RENDER_COMMAND::TYPE::BEGIN_DEFAULT_PASS:
+				forget_state();
+				pass = i;
+				foldable = false;
+				break;
+			case RENDER_COMMAND::TYPE::BEGIN_PASS:
+			{
+				// passes that clear can't be folded
+				forget_state();
+				pass = i;
+				foldable = true;
+				pass_debug_depth = 0;
+				const sg_pass_action& pass_action = command.begin_pass.pass_action;
+				for (const auto& color : pass_action.colors)
+				{
+					foldable = foldable && (color.load_action == SG_LOADACTION_LOAD || color.load_action == SG_LOADACTION_DONTCARE);
+				}
+				foldable = foldable && (pass_action.depth.load_action == SG_LOADACTION_LOAD || pass_action.depth.load_action == SG_LOADACTION_DONTCARE);
+				foldable = foldable && (pass_action.stencil.load_action == SG_LOADACTION_LOAD || pass_action.stencil.load_action == SG_LOADACTION_DONTCARE);
+				break;
+			}
+			case RENDER_COMMAND::TYPE::APPLY_VIEWPORT:
+				remove_state(viewport);
+				viewport = i;
+				break;
+			case RENDER_COMMAND::TYPE::APPLY_SCISSOR_RECT:
+				remove_state(scissor_rect);
+				scissor_rect = i;
+				break;
+			case RENDER_COMMAND::TYPE::APPLY_PIPELINE:
+				remove_pipeline_state();
+				pipeline = i;
+				break;
+			case RENDER_COMMAND::TYPE::APPLY_BINDINGS:
+			case RENDER_COMMAND::TYPE::APPLY_BINDING_SET:
+				remove_state(bindings);
+				bindings = i;
+				break;
+			case RENDER_COMMAND::TYPE::APPLY_UNIFORMS:
+				// invalid slot?
+				if ((int)command.apply_uniforms.stage < 0 || (int)command.apply_uniforms.stage >= SG_NUM_SHADER_STAGES || command.apply_uniforms.ub_index < 0 || command.apply_uniforms.ub_index >= SG_MAX_SHADERSTAGE_UBS)
+				{
+					forget_state();
+					foldable = false;
+					break;
+				}
+				remove_state(uniforms[command.apply_uniforms.stage][command.apply_uniforms.ub_index]);
+				uniforms[command.apply_uniforms.stage][command.apply_uniforms.ub_index] = i;
+				break;
+			case RENDER_COMMAND::TYPE::DRAW:
+				// nothing to draw?
+				if (command.draw.number_of_elements <= 0 || command.draw.number_of_instances <= 0)
+				{
+					command.type = RENDER_COMMAND::TYPE::NOT_SET;
+					m_frame_stats.number_of_empty_draws ++;
+					break;
+				}
+				forget_state();
+				foldable = false;
+				break;
+			case RENDER_COMMAND::TYPE::END_PASS:
+				// state not used by the end of the pass is dead
+				remove_pipeline_state();
+				remove_state(viewport);
+				remove_state(scissor_rect);
+
+				// fold pass?
+				if (pass >= 0 && foldable && pass_debug_depth == 0)
+				{
+					for (int32_t j = pass; j <= i; j ++)
+					{
+						commands[j].type = RENDER_COMMAND::TYPE::NOT_SET;
+					}
+					m_frame_stats.number_of_folded_passes ++;
+				}
+				pass = -1;
+				foldable = false;
+				break;
+			case RENDER_COMMAND::TYPE::PUSH_DEBUG_GROUP:
+				pass_debug_depth ++;
+				break;
+			case RENDER_COMMAND::TYPE::POP_DEBUG_GROUP:
+				foldable = foldable && pass_debug_depth > 0;
+				pass_debug_depth --;
+				break;
+			case RENDER_COMMAND::TYPE::MAKE_BUFFER:
+			case RENDER_COMMAND::TYPE::MAKE_IMAGE:
+			case RENDER_COMMAND::TYPE::MAKE_SHADER:
+			case RENDER_COMMAND::TYPE::MAKE_PIPELINE:
+			case RENDER_COMMAND::TYPE::MAKE_PASS:
+			case RENDER_COMMAND::TYPE::DESTROY_BUFFER:
+			case RENDER_COMMAND::TYPE::DESTROY_IMAGE:
+			case RENDER_COMMAND::TYPE::DESTROY_SHADER:
+			case RENDER_COMMAND::TYPE::DESTROY_PIPELINE:
+			case RENDER_COMMAND::TYPE::DESTROY_PASS:
+			case RENDER_COMMAND::TYPE::UPDATE_BUFFER:
+			case RENDER_COMMAND::TYPE::APPEND_BUFFER:
+			case RENDER_COMMAND::TYPE::UPDATE_IMAGE:
+				// resource commands don't touch state but are never removed
+				foldable = false;
+				break;
+			default:
+				// custom commands may draw, so everything applied so far is live
+				forget_state();
+				foldable = false;
+				break;
+			}
+		}
+	}
+
+	// loop through commands, removing debug groups that are stripped or end up empty
+	m_optimize_debug_groups.resize(0);
+	for (int32_t i = 0; i < (int32_t)commands.size(); i ++)
+	{
+		RENDER_COMMAND& command = commands[i];
+		switch (command.type)
+		{
+		case RENDER_COMMAND::TYPE::NOT_SET:
+			break;
+		case RENDER_COMMAND::TYPE::PUSH_DEBUG_GROUP:
+			// strip?
+			if (m_strip_debug_groups)
+			{
+				command.type = RENDER_COMMAND::TYPE::NOT_SET;
+				m_frame_stats.number_of_removed_debug_groups ++;
+				break;
+			}
+			m_optimize_debug_groups.emplace_back(i, false);
+			break;
+		case RENDER_COMMAND::TYPE::POP_DEBUG_GROUP:
+			// strip, or pushed before these commands?
+			if (m_strip_debug_groups)
+			{
+				command.type = RENDER_COMMAND::TYPE::NOT_SET;
+				break;
+			}
+			if (m_optimize_debug_groups.empty())
+			{
+				break;
+			}
+
+			// remove empty group
+			if (!m_optimize_debug_groups.back().second)
+			{
+				commands[m_optimize_debug_groups.back().first].type = RENDER_COMMAND::TYPE::NOT_SET;
+				command.type = RENDER_COMMAND::TYPE::NOT_SET;
+				m_frame_stats.number_of_removed_debug_groups ++;
+				m_optimize_debug_groups.pop_back();
+				break;
+			}
+
+			// parent isn't empty either
+			m_optimize_debug_groups.pop_back();
+			if (!m_optimize_debug_groups.empty())
+			{
+				m_optimize_debug_groups.back().second = true;
+			}
+			break;
+		default:
+			// group isn't empty
+			if (!m_optimize_debug_groups.empty())
+			{
+				m_optimize_debug_groups.back().second = true;
+			}
+			break;
+		}
+	}
+
+	// end trace
+	trace_end(TRACE::THREAD::UPDATE);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::cull_range(CULL_FRUSTUM& frustum, size_t begin, size_t end)
+{
+	// setup input
+	CULL_INPUT input = { &frustum.planes[0][0], &frustum.abs_normals[0][0], frustum.center_x.data(), frustum.center_y.data(), frustum.center_z.data(), frustum.extents_x.data(), frustum.extents_y.data(), frustum.extents_z.data(), frustum.radius.data(), frustum.visible.data() };
+
+#if defined(RENDERER_SIMD_X64)
+	// cull 8 or 4 at a time
+	static const bool avx2 = has_avx2();
+	if (avx2)
+	{
+		begin = cull_avx2(input, begin, end);
+	}
+	begin = cull_sse(input, begin, end);
+#endif
+
+	// cull remainder
+	cull_scalar(input, begin, end);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::execute_frame(bool resource_only)
+{
+	// begin trace
+	trace_begin(TRACE::THREAD::RENDER, "execute_commands");
+
+	// bindings applied last frame may have been changed outside the renderer
+	m_last_binding_set = 0;
+
+	// time spent executing, not waiting for chunks
+	std::chrono::steady_clock::duration execute_time = {};
+
+	{
+		// lock partial mutex
+		std::unique_lock<std::mutex> lock(m_partial_mutex);
+
+		// loop through chunks submitted with submit_partial() until the frame is committed
+		while (m_partial_frame_open || !m_partial_chunks.empty())
+		{
+			// wait for chunk
+			if (m_partial_chunks.empty())
+			{
+				trace_begin(TRACE::THREAD::RENDER, "wait_for_partial");
+				m_partial_cv.wait(lock);
+				trace_end(TRACE::THREAD::RENDER);
+				continue;
+			}
+
+			// take chunk
+			RENDER_COMMAND_ARRAY chunk = std::move(m_partial_chunks.front());
+			m_partial_chunks.pop_front();
+
+			// execute chunk without holding the partial mutex
+			lock.unlock();
+			auto start_time = std::chrono::steady_clock::now();
+			execute_command_array(chunk, resource_only);
+			execute_time += std::chrono::steady_clock::now() - start_time;
+			chunk.resize(0);
+			lock.lock();
+
+			// recycle chunk
+			m_free_partial_chunks.push_back(std::move(chunk));
+		}
+	}
+
+	// execute committed commands
+	auto start_time = std::chrono::steady_clock::now();
+	execute_command_array(m_commands[m_commit_commands_index], resource_only);
+	execute_time += std::chrono::steady_clock::now() - start_time;
+
+	// publish execute time, before the executed frame index
+	m_execute_time.store(std::chrono::duration<double, std::milli>(execute_time).count(), std::memory_order_relaxed);
+
+	// end trace
+	trace_end(TRACE::THREAD::RENDER);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::publish_executed_frame_index(int32_t frame_index)
+{
+	// publish frame index
+	m_executed_frame_index.store(frame_index);
+
+	// wake fence waiters
+	if (m_number_of_fence_waiters.load())
+	{
+		{
+			std::scoped_lock<std::mutex> lock(m_fence_mutex);
+		}
+		m_fence_cv.notify_all();
+	}
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::publish_teardown_time()
+{
+	// publish time since flush_commands() or reset() was called
+	m_teardown_time.store(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_teardown_start_time).count(), std::memory_order_relaxed);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::execute_command_array(RENDER_COMMAND_ARRAY& commands, bool resource_only)
+{
+	// lock execute mutex
+	std::scoped_lock<std::mutex> lock(m_execute_mutex);
+
+	// flushing with fast teardown? resources are about to be released by sg_shutdown() so they aren't made or destroyed
+	const bool skip_resources = resource_only && m_fast_teardown.load(std::memory_order_relaxed) && m_flushing;
+
+	// loop through commands
+	for (auto& command : commands)
+	{
+		// ignore command?
+		if (resource_only && (skip_resources || !((command.type >= RENDER_COMMAND::TYPE::MAKE_BUFFER && command.type <= RENDER_COMMAND::TYPE::DESTROY_PASS) || command.type == RENDER_COMMAND::TYPE::RESET)))
+		{
+			// closures are still destroyed
+			if (command.type == RENDER_COMMAND::TYPE::CUSTOM_CLOSURE)
+			{
+				command.destroy_closure();
+			}
+			continue;
+		}
+
+		// execute command
+		switch (command.type)
+		{
+		case RENDER_COMMAND::TYPE::PUSH_DEBUG_GROUP:
+			sg_push_debug_group(command.push_debug_group.name);
+			trace_begin(TRACE::THREAD::RENDER, command.push_debug_group.name);
+			break;
+		case RENDER_COMMAND::TYPE::POP_DEBUG_GROUP:
+			trace_end(TRACE::THREAD::RENDER);
+			sg_pop_debug_group();
+			break;
+		case RENDER_COMMAND::TYPE::MAKE_BUFFER:
+			sg_init_buffer(command.make_buffer.buffer, command.make_buffer.desc);
+			break;
+		case RENDER_COMMAND::TYPE::MAKE_IMAGE:
+			sg_init_image(command.make_image.image, command.make_image.desc);
+			break;
+		case RENDER_COMMAND::TYPE::MAKE_SHADER:
+			sg_init_shader(command.make_shader.shader, command.make_shader.desc);
+			break;
+		case RENDER_COMMAND::TYPE::MAKE_PIPELINE:
+			sg_init_pipeline(command.make_pipeline.pipeline, command.make_pipeline.desc);
+			break;
+		case RENDER_COMMAND::TYPE::MAKE_PASS:
+			sg_init_pass(command.make_pass.pass, command.make_pass.desc);
+			break;
+		case RENDER_COMMAND::TYPE::DESTROY_BUFFER:
+			sg_uninit_buffer(command.destroy_buffer.buffer);
+			break;
+		case RENDER_COMMAND::TYPE::DESTROY_IMAGE:
+			sg_uninit_image(command.destroy_image.image);
+			break;
+		case RENDER_COMMAND::TYPE::DESTROY_SHADER:
+			sg_uninit_shader(command.destroy_shader.shader);
+			break;
+		case RENDER_COMMAND::TYPE::DESTROY_PIPELINE:
+			sg_uninit_pipeline(command.destroy_pipeline.pipeline);
+			break;
+		case RENDER_COMMAND::TYPE::DESTROY_PASS:
+			sg_uninit_pass(command.destroy_pass.pass);
+			break;
+		case RENDER_COMMAND::TYPE::UPDATE_BUFFER:
+			sg_update_buffer(command.update_buffer.buffer, command.update_buffer.data);
+			break;
+		case RENDER_COMMAND::TYPE::APPEND_BUFFER:
+			sg_append_buffer(command.append_buffer.buffer, command.append_buffer.data);
+			break;
+		case RENDER_COMMAND::TYPE::UPDATE_IMAGE:
+			sg_update_image(command.update_image.image, command.update_image.data);
+			break;
+		case RENDER_COMMAND::TYPE::BEGIN_DEFAULT_PASS:
+			sg_begin_default_pass(command.begin_default_pass.pass_action, m_default_pass_width, m_default_pass_height);
+			m_last_binding_set = 0;
+
+			// scaled?
+			m_pass_resolution_scale = command.begin_default_pass.resolution_scale;
+			m_pass_width = m_default_pass_width;
+			m_pass_height = m_default_pass_height;
+			if (m_pass_resolution_scale != 1.0f)
+			{
+				apply_scaled_rect(RENDER_COMMAND::TYPE::APPLY_VIEWPORT, 0, 0, m_pass_width, m_pass_height, true);
+			}
+			break;
+		case RENDER_COMMAND::TYPE::BEGIN_PASS:
+			sg_begin_pass(command.begin_pass.pass, command.begin_pass.pass_action);
+			m_last_binding_set = 0;
+
+			// scaled?
+			m_pass_resolution_scale = command.begin_pass.resolution_scale;
+			m_pass_width = command.begin_pass.width;
+			m_pass_height = command.begin_pass.height;
+			if (m_pass_resolution_scale != 1.0f)
+			{
+				apply_scaled_rect(RENDER_COMMAND::TYPE::APPLY_VIEWPORT, 0, 0, m_pass_width, m_pass_height, true);
+			}
+			break;
+		case RENDER_COMMAND::TYPE::APPLY_VIEWPORT:
+			if (m_pass_resolution_scale != 1.0f)
+			{
+				apply_scaled_rect(RENDER_COMMAND::TYPE::APPLY_VIEWPORT, command.apply_viewport.x, command.apply_viewport.y, command.apply_viewport.width, command.apply_viewport.height, command.apply_viewport.origin_top_left);
+				break;
+			}
+			sg_apply_viewport(command.apply_viewport.x, command.apply_viewport.y, command.apply_viewport.width, command.apply_viewport.height, command.apply_viewport.origin_top_left);
+			break;
+		case RENDER_COMMAND::TYPE::APPLY_SCISSOR_RECT:
+			if (m_pass_resolution_scale != 1.0f)
+			{
+				apply_scaled_rect(RENDER_COMMAND::TYPE::APPLY_SCISSOR_RECT, command.apply_scissor_rect.x, command.apply_scissor_rect.y, command.apply_scissor_rect.width, command.apply_scissor_rect.height, command.apply_scissor_rect.origin_top_left);
+				break;
+			}
+			sg_apply_scissor_rect(command.apply_scissor_rect.x, command.apply_scissor_rect.y, command.apply_scissor_rect.width, command.apply_scissor_rect.height, command.apply_scissor_rect.origin_top_left);
+			break;
+		case RENDER_COMMAND::TYPE::APPLY_PIPELINE:
+			sg_apply_pipeline(command.apply_pipeline.pipeline);
+			m_last_binding_set = 0;
+			break;
+		case RENDER_COMMAND::TYPE::APPLY_BINDINGS:
+			sg_apply_bindings(command.apply_bindings.bindings);
+			m_last_binding_set = 0;
+			break;
+		case RENDER_COMMAND::TYPE::APPLY_BINDING_SET:
+			// offsets?
+			if (command.apply_binding_set.offsets)
+			{
+				// apply set with offsets
+				sg_bindings bindings = get_binding_set(command.apply_binding_set.binding_set);
+				memcpy(bindings.vertex_buffer_offsets, command.apply_binding_set.vertex_buffer_offsets, sizeof(bindings.vertex_buffer_offsets));
+				bindings.index_buffer_offset = command.apply_binding_set.index_buffer_offset;
+				sg_apply_bindings(bindings);
+				m_last_binding_set = 0;
+			}
+			else if (command.apply_binding_set.binding_set != m_last_binding_set)
+			{
+				// apply set, unless it's already applied
+				sg_apply_bindings(get_binding_set(command.apply_binding_set.binding_set));
+				m_last_binding_set = command.apply_binding_set.binding_set;
+			}
+			break;
+		case RENDER_COMMAND::TYPE::APPLY_UNIFORMS:
+			sg_apply_uniforms(command.apply_uniforms.stage, command.apply_uniforms.ub_index, { command.apply_uniforms.buf, command.apply_uniforms.data_size });
+			break;
+		case RENDER_COMMAND::TYPE::DRAW:
+			sg_draw(command.draw.base_element, command.draw.number_of_elements, command.draw.number_of_instances);
+			break;
+		case RENDER_COMMAND::TYPE::END_PASS:
+			sg_end_pass();
+			m_pass_resolution_scale = 1.0f;
+			break;
+		case RENDER_COMMAND::TYPE::COMMIT:
+			sg_commit();
+			break;
+		case RENDER_COMMAND::TYPE::RESET:
+			// destroy everything in one go and start again
+			sg_shutdown();
+			sg_setup(m_desc);
+			m_last_binding_set = 0;
+
+			// forget host handles, reset() ends the frame so nothing after this was translated with them
+			for (auto& handles : m_ring_handles)
+			{
+				handles.clear();
+			}
+			m_ring_deallocs.resize(0);
+			break;
+		case RENDER_COMMAND::TYPE::CUSTOM:
+			command.custom.custom_cb(command.custom.custom_data);
+			m_last_binding_set = 0;
+			break;
+		case RENDER_COMMAND::TYPE::CUSTOM_CLOSURE:
+			command.custom_closure.invoke_cb(command.get_closure());
+			command.destroy_closure();
+			m_last_binding_set = 0;
+			break;
+		case RENDER_COMMAND::TYPE::NOT_SET:
+			break;
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::apply_scaled_rect(RENDER_COMMAND::TYPE::ENUM type, int x, int y, int width, int height, bool origin_top_left)
+{
+	// make origin top left, the scaled region is anchored there
+	if (!origin_top_left)
+	{
+		y = m_pass_height - y - height;
+	}
+
+	// scale edges so adjacent rects stay adjacent
+	const float scale = m_pass_resolution_scale;
+	const int left = (int)floorf(x * scale);
+	const int top = (int)floorf(y * scale);
+	const int right = (int)floorf((x + width) * scale);
+	const int bottom = (int)floorf((y + height) * scale);
+
+	// apply rect
+	if (type == RENDER_COMMAND::TYPE::APPLY_VIEWPORT)
+	{
+		sg_apply_viewport(left, top, right - left, bottom - top, true);
+	}
+	else
+	{
+		sg_apply_scissor_rect(left, top, right - left, bottom - top, true);
+	}
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::destroy_closures(RENDER_COMMAND_ARRAY& commands)
+{
+	// loop through commands
+	for (auto& command : commands)
+	{
+		// destroy closure?
+		if (command.type == RENDER_COMMAND::TYPE::CUSTOM_CLOSURE)
+		{
+			command.destroy_closure();
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::render_thread_loop()
+{
+	// apply affinity and priority
+	apply_render_thread_settings(m_render_thread_desc);
+
+	// call thread start cb
+	if (m_render_thread_desc.thread_start_cb)
+	{
+		m_render_thread_desc.thread_start_cb(m_render_thread_desc.user_data);
+	}
+
+	// setup sokol graphics, now the start cb has made the context current
+	complete_setup();
+
+	// initialise finished flushing
+	bool finished_flushing = false;
+
+	// render loop
+	while (!finished_flushing)
+	{
+		// acquire update semaphore, flush_commands() sets flushing before releasing it
+		trace_begin(TRACE::THREAD::RENDER, "wait_for_commit");
+
+		// build prewarmed shaders/pipelines until a commit is ready
+		bool acquired = m_update_semaphore.try_acquire();
+		while (!acquired && build_prewarm_entry())
+		{
+			acquired = m_update_semaphore.try_acquire();
+		}
+
+		// wait for commit
+		if (!acquired)
+		{
+			switch (m_render_thread_desc.wait_policy)
+			{
+			case RENDER_THREAD_DESC::WAIT_POLICY::BLOCK:
+				m_update_semaphore.acquire();
+				break;
+			case RENDER_THREAD_DESC::WAIT_POLICY::SPIN:
+				while (!m_update_semaphore.spin_acquire(m_render_thread_desc.spin_count))
+				{
+					std::this_thread::yield();
+				}
+				break;
+			case RENDER_THREAD_DESC::WAIT_POLICY::HYBRID:
+				if (!m_update_semaphore.spin_acquire(m_render_thread_desc.spin_count))
+				{
+					m_update_semaphore.acquire();
+				}
+				break;
+			}
+		}
+		trace_end(TRACE::THREAD::RENDER);
+
+		// update finished flushing
+		finished_flushing = m_flushing;
+
+		// execute frame, only resource commands once flushing
+		execute_frame(finished_flushing);
+		publish_executed_frame_index(m_commit_frame_index);
+		if (finished_flushing)
+		{
+			publish_teardown_time();
+		}
+
+		// release render semaphore
+		m_render_semaphore.release();
+
+		// call frame cb
+		if (!finished_flushing && m_render_thread_desc.frame_cb)
+		{
+			m_render_thread_desc.frame_cb(m_render_thread_desc.user_data);
+		}
+	}
+
+	// shutdown sokol graphics, if this thread set it up, before the end cb releases the context
+	complete_shutdown();
+
+	// call thread end cb
+	if (m_render_thread_desc.thread_end_cb)
+	{
+		m_render_thread_desc.thread_end_cb(m_render_thread_desc.user_data);
+	}
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::add_command_push_debug_group(const char* name)
+{
+	// add command
+	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::PUSH_DEBUG_GROUP);
+
+	// copy args
+	command.push_debug_group.name = name;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::add_command_pop_debug_group()
+{
+	// add command
+	/*RENDER_COMMAND& command = */m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::POP_DEBUG_GROUP);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+sg_buffer RENDERER::add_command_make_buffer(const sg_buffer_desc& desc)
+{
+	// add command
+	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::MAKE_BUFFER);
+
+	// copy args
+	command.make_buffer.desc = desc;
+	
+	// alloc buffer
+	command.make_buffer.buffer = alloc_buffer();
+	
+	// return buffer
+	return command.make_buffer.buffer;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+sg_image RENDERER::add_command_make_image(const sg_image_desc& desc)
+{
+	// add command
+	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::MAKE_IMAGE);
+
+	// copy args
+	command.make_image.desc = desc;
+
+	// alloc image
+	command.make_image.image = alloc_image();
+	
+	// return image
+	return command.make_image.image;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+sg_shader RENDERER::add_command_make_shader(const sg_shader_desc& desc)
+{
+	// recording or prewarming?
+	uint64_t hash = 0;
+	uint32_t prewarm_id = SG_INVALID_ID;
+	bool built = false;
+	if (m_record_manifest || !m_prewarm_lookup.empty())
+	{
+		// hash desc
+		RENDER_COMMAND manifest_command;
+		clear_manifest_command(manifest_command, RENDER_COMMAND::TYPE::MAKE_SHADER);
+		manifest_command.make_shader.desc = desc;
+		hash = record_manifest_command(manifest_command, 0);
+
+		// claim prewarmed shader
+		prewarm_id = claim_prewarm_entry(hash, SG_INVALID_ID, built);
+	}
+
+	// already built on the render thread?
+	if (built)
+	{
+		m_manifest_shader_hashes[prewarm_id] = hash;
+		return { prewarm_id };
+	}
+
+	// add command
+	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::MAKE_SHADER);
+
+	// copy args
+	command.make_shader.desc = desc;
+
+	// alloc shader, unless the manifest reserved one
+	command.make_shader.shader = prewarm_id != SG_INVALID_ID ? sg_shader{ prewarm_id } : alloc_shader();
+
+	// remember hash for pipelines using the shader
+	if (hash)
+	{
+		m_manifest_shader_hashes[command.make_shader.shader.id] = hash;
+	}
+	
+	// return shader
+	return command.make_shader.shader;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+sg_pipeline RENDERER::add_command_make_pipeline(const sg_pipeline_desc& desc)
+{
+	// recording or prewarming?
+	uint32_t prewarm_id = SG_INVALID_ID;
+	bool built = false;
+	if (m_record_manifest || !m_prewarm_lookup.empty())
+	{
+		// shader in manifest?
+		auto it = m_manifest_shader_hashes.find(desc.shader.id);
+		if (it != m_manifest_shader_hashes.end())
+		{
+			// hash desc, the shader is identified by its hash rather than its handle
+			RENDER_COMMAND manifest_command;
+			clear_manifest_command(manifest_command, RENDER_COMMAND::TYPE::MAKE_PIPELINE);
+			manifest_command.make_pipeline.desc = desc;
+			manifest_command.make_pipeline.desc.shader.id = SG_INVALID_ID;
+			uint64_t hash = record_manifest_command(manifest_command, it->second);
+
+			// claim prewarmed pipeline
+			prewarm_id = claim_prewarm_entry(hash, desc.shader.id, built);
+		}
+	}
+
+	// already built on the render thread?
+	if (built)
+	{
+		return { prewarm_id };
+	}
+
+	// add command
+	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::MAKE_PIPELINE);
+
+	// copy args
+	command.make_pipeline.desc = desc;
+
+	// alloc pipeline, unless the manifest reserved one
+	command.make_pipeline.pipeline = prewarm_id != SG_INVALID_ID ? sg_pipeline{ prewarm_id } : alloc_pipeline();
+	
+	// return pipeline
+	return command.make_pipeline.pipeline;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+sg_pass RENDERER::add_command_make_pass(const sg_pass_desc& desc)
+{
+	// add command
+	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::MAKE_PASS);
+
+	// copy args
+	command.make_pass.desc = desc;
+
+	// alloc pass
+	command.make_pass.pass = alloc_pass();
+	
+	// return pass
+	return command.make_pass.pass;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::add_command_destroy_buffer(sg_buffer buffer)
+{
+	// add command
+	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::DESTROY_BUFFER);
+
+	// copy args
+	command.destroy_buffer.buffer = buffer;
+
+	// schedule cleanup, a remote host deallocates its own handles so only the client handle is recycled
+	if (!m_ring)
+	{
+		schedule_synchronous_cleanup(dealloc_buffer_cb, (void*)(uintptr_t)command.destroy_buffer.buffer.id);
+	}
+	else
+	{
+		free_ring_handle(RESOURCE_TYPE::BUFFER, command.destroy_buffer.buffer.id);
+	}
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::add_command_destroy_image(sg_image image)
+{
+	// still being prepared? destroyed once its jobs have been added, so the make doesn't init a deallocated handle
+	auto it = m_texture_jobs.find(image.id);
+	if (it != m_texture_jobs.end())
+	{
+		it->second.destroy = true;
+		return;
+	}
+
+	// add command
+	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::DESTROY_IMAGE);
+
+	// copy args
+	command.destroy_image.image = image;
+
+	// schedule cleanup, a remote host deallocates its own handles so only the client handle is recycled
+	if (!m_ring)
+	{
+		schedule_synchronous_cleanup(dealloc_image_cb, (void*)(uintptr_t)command.destroy_image.image.id);
+	}
+	else
+	{
+		free_ring_handle(RESOURCE_TYPE::IMAGE, command.destroy_image.image.id);
+	}
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::add_command_destroy_shader(sg_shader shader)
+{
+	// add command
+	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::DESTROY_SHADER);
+
+	// copy args
+	command.destroy_shader.shader = shader;
+
+	// forget manifest hash
+	m_manifest_shader_hashes.erase(shader.id);
+
+	// schedule cleanup, a remote host deallocates its own handles so only the client handle is recycled
+	if (!m_ring)
+	{
+		schedule_synchronous_cleanup(dealloc_shader_cb, (void*)(uintptr_t)command.destroy_shader.shader.id);
+	}
+	else
+	{
+		free_ring_handle(RESOURCE_TYPE::SHADER, command.destroy_shader.shader.id);
+	}
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::add_command_destroy_pipeline(sg_pipeline pipeline)
+{
+	// add command
+	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::DESTROY_PIPELINE);
+
+	// copy args
+	command.destroy_pipeline.pipeline = pipeline;
+
+	// schedule cleanup, a remote host deallocates its own handles so only the client handle is recycled
+	if (!m_ring)
+	{
+		schedule_synchronous_cleanup(dealloc_pipeline_cb, (void*)(uintptr_t)command.destroy_pipeline.pipeline.id);
+	}
+	else
+	{
+		free_ring_handle(RESOURCE_TYPE::PIPELINE, command.destroy_pipeline.pipeline.id);
+	}
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::add_command_destroy_pass(sg_pass pass)
+{
+	// add command
+	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::DESTROY_PASS);
+
+	// copy args
 	command.destroy_pass.pass = pass;
 
-	// schedule cleanup
-	schedule_cleanup(dealloc_pass_cb, (void*)(uintptr_t)command.destroy_pass.pass.id);
+	// schedule cleanup, a remote host deallocates its own handles so only the client handle is recycled
+	if (!m_ring)
+	{
+		schedule_synchronous_cleanup(dealloc_pass_cb, (void*)(uintptr_t)command.destroy_pass.pass.id);
+	}
+	else
+	{
+		free_ring_handle(RESOURCE_TYPE::PASS, command.destroy_pass.pass.id);
+	}
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::add_command_update_buffer(sg_buffer buffer, const sg_range& data)
+{
+	// add command
+	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::UPDATE_BUFFER);
+
+	// copy args
+	command.update_buffer.buffer = buffer;
+	command.update_buffer.data = data;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::add_command_append_buffer(sg_buffer buffer, const sg_range& data)
+{
+	// add command
+	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::APPEND_BUFFER);
+
+	// copy args
+	command.append_buffer.buffer = buffer;
+	command.append_buffer.data = data;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::add_command_update_image(sg_image image, const sg_image_data& data)
+{
+	// add command
+	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::UPDATE_IMAGE);
+
+	// copy args
+	command.update_image.image = image;
+	command.update_image.data = data;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+sg_image RENDERER::add_command_make_image_async(const RENDER_TEXTURE_DESC& desc)
+{
+	// invalid?
+	if (!desc.data || desc.width <= 0 || desc.height <= 0 || !TEXTURE_PREP::is_supported(desc.source_pixel_format) || !TEXTURE_PREP::is_supported(desc.pixel_format))
+	{
+		return {};
+	}
+
+	// alloc image, it stays allocated (draws using it are skipped) until the make command executes
+	sg_image image = alloc_image();
+
+	// submit job
+	submit_texture_job(image, true, desc);
+
+	// return image
+	return image;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::add_command_update_image_async(sg_image image, const RENDER_TEXTURE_DESC& desc)
+{
+	// invalid?
+	if (!desc.data || desc.width <= 0 || desc.height <= 0 || !TEXTURE_PREP::is_supported(desc.source_pixel_format) || !TEXTURE_PREP::is_supported(desc.pixel_format))
+	{
+		return;
+	}
+
+	// submit job
+	submit_texture_job(image, false, desc);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::add_command_begin_default_pass(const sg_pass_action& pass_action)
+{
+	// add command
+	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::BEGIN_DEFAULT_PASS);
+
+	// copy args
+	command.begin_default_pass.pass_action = pass_action;
+	command.begin_default_pass.resolution_scale = m_resolution_scale;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::add_command_begin_pass(sg_pass pass, const sg_pass_action& pass_action)
+{
+	// add command
+	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::BEGIN_PASS);
+
+	// copy args
+	command.begin_pass.pass = pass;
+	command.begin_pass.pass_action = pass_action;
+	command.begin_pass.resolution_scale = 1.0f;
+	command.begin_pass.width = 0;
+	command.begin_pass.height = 0;
+
+	// scalable?
+	auto scalable_pass = m_scalable_passes.find(pass.id);
+	if (scalable_pass != m_scalable_passes.end())
+	{
+		command.begin_pass.resolution_scale = m_resolution_scale;
+		command.begin_pass.width = scalable_pass->second.first;
+		command.begin_pass.height = scalable_pass->second.second;
+	}
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::add_command_apply_viewport(int x, int y, int width, int height, bool origin_top_left)
+{
+	// add command
+	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::APPLY_VIEWPORT);
+
+	// copy args
+	command.apply_viewport.x = x;
+	command.apply_viewport.y = y;
+	command.apply_viewport.width = width;
+	command.apply_viewport.height = height;
+	command.apply_viewport.origin_top_left = origin_top_left;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::add_command_apply_scissor_rect(int x, int y, int width, int height, bool origin_top_left)
+{
+	// add command
+	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::APPLY_SCISSOR_RECT);
+
+	// copy args
+	command.apply_scissor_rect.x = x;
+	command.apply_scissor_rect.y = y;
+	command.apply_scissor_rect.width = width;
+	command.apply_scissor_rect.height = height;
+	command.apply_scissor_rect.origin_top_left = origin_top_left;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::add_command_apply_pipeline(sg_pipeline pipeline)
+{
+	// add command
+	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::APPLY_PIPELINE);
+
+	// copy args
+	command.apply_pipeline.pipeline = pipeline;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::add_command_apply_bindings(const sg_bindings& bindings)
+{
+	// add command
+	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::APPLY_BINDINGS);
+
+	// copy args
+	command.apply_bindings.bindings = bindings;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::add_command_apply_binding_set(uint32_t binding_set)
+{
+	// invalid?
+	if (!is_binding_set(binding_set))
+	{
+		return;
+	}
+
+	// remote? the host doesn't have the set so send the bindings
+	if (m_ring)
+	{
+		add_command_apply_bindings(get_binding_set(binding_set));
+		return;
+	}
+
+	// add command
+	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::APPLY_BINDING_SET);
+
+	// copy args
+	command.apply_binding_set.binding_set = binding_set;
+	command.apply_binding_set.offsets = false;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::add_command_apply_binding_set(uint32_t binding_set, const int* vertex_buffer_offsets, int number_of_vertex_buffer_offsets, int index_buffer_offset)
+{
+	// invalid?
+	if (!is_binding_set(binding_set))
+	{
+		return;
+	}
+
+	// override offsets
+	const sg_bindings& bindings = get_binding_set(binding_set);
+	int offsets[SG_MAX_SHADERSTAGE_BUFFERS];
+	for (int i = 0; i < SG_MAX_SHADERSTAGE_BUFFERS; i ++)
+	{
+		offsets[i] = i < number_of_vertex_buffer_offsets ? vertex_buffer_offsets[i] : bindings.vertex_buffer_offsets[i];
+	}
+
+	// remote? the host doesn't have the set so send the bindings
+	if (m_ring)
+	{
+		sg_bindings remote_bindings = bindings;
+		memcpy(remote_bindings.vertex_buffer_offsets, offsets, sizeof(offsets));
+		remote_bindings.index_buffer_offset = index_buffer_offset;
+		add_command_apply_bindings(remote_bindings);
+		return;
+	}
+
+	// add command
+	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::APPLY_BINDING_SET);
+
+	// copy args
+	command.apply_binding_set.binding_set = binding_set;
+	command.apply_binding_set.offsets = true;
+	memcpy(command.apply_binding_set.vertex_buffer_offsets, offsets, sizeof(offsets));
+	command.apply_binding_set.index_buffer_offset = index_buffer_offset;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+uint32_t RENDERER::create_binding_set(const sg_bindings& bindings)
+{
+	// already interned?
+	uint64_t hash = hash_bytes(&bindings, sizeof(bindings));
+	auto it = m_binding_set_lookup.find(hash);
+	if (it != m_binding_set_lookup.end() && !memcmp(&get_binding_set(it->second), &bindings, sizeof(bindings)))
+	{
+		m_binding_set_refs[it->second - 1] ++;
+		return it->second;
+	}
+
+	// reuse a destroyed set once the render thread has executed the last frame that could apply it
+	uint32_t binding_set = 0;
+	if (!m_free_binding_sets.empty() && get_executed_frame_index() >= m_free_binding_sets.front().first)
+	{
+		binding_set = m_free_binding_sets.front().second;
+		m_free_binding_sets.pop_front();
+	}
+
+	// out of sets?
+	else if (m_number_of_binding_sets == BINDING_SET_PAGE_SIZE * MAX_BINDING_SET_PAGES)
+	{
+		m_frame_stats.number_of_failed_binding_sets ++;
+		return 0;
+	}
+
+	// allocate page, pages never move so the render thread can read sets without locking
+	else
+	{
+		binding_set = ++ m_number_of_binding_sets;
+		m_binding_set_refs.push_back(0);
+		std::unique_ptr<sg_bindings[]>& page = m_binding_set_pages[(binding_set - 1) / BINDING_SET_PAGE_SIZE];
+		if (!page)
+		{
+			page.reset(new sg_bindings[BINDING_SET_PAGE_SIZE]);
+		}
+	}
+
+	// copy bindings
+	m_binding_set_pages[(binding_set - 1) / BINDING_SET_PAGE_SIZE][(binding_set - 1) % BINDING_SET_PAGE_SIZE] = bindings;
+	m_binding_set_refs[binding_set - 1] = 1;
+	m_number_of_live_binding_sets ++;
+
+	// add to lookup, unless a different set has the same hash
+	m_binding_set_lookup.emplace(hash, binding_set);
+
+	// return set
+	return binding_set;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::destroy_binding_set(uint32_t binding_set)
+{
+	// invalid or still created elsewhere?
+	if (!is_binding_set(binding_set) || -- m_binding_set_refs[binding_set - 1])
+	{
+		return;
+	}
+
+	// remove from lookup, unless the hash belongs to a different set
+	auto it = m_binding_set_lookup.find(hash_bytes(&get_binding_set(binding_set), sizeof(sg_bindings)));
+	if (it != m_binding_set_lookup.end() && it->second == binding_set)
+	{
+		m_binding_set_lookup.erase(it);
+	}
+
+	// free once this frame has executed, commands recorded so far may still apply it
+	m_free_binding_sets.emplace_back(m_frame_index, binding_set);
+	m_number_of_live_binding_sets --;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::add_command_apply_uniforms(sg_shader_stage stage, int ub_index, const sg_range& data)
+{
+	// data size too big?
+	if ((size_t)data.size > sizeof(RENDER_COMMAND::apply_uniforms.buf))
+	{
+		return;
+	}
+
+	// add command
+	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::APPLY_UNIFORMS);
+
+	// copy args
+	command.apply_uniforms.stage = stage;
+	command.apply_uniforms.ub_index = ub_index;
+	memcpy(command.apply_uniforms.buf, data.ptr, data.size);
+	command.apply_uniforms.data_size = data.size;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::add_command_draw(int base_element, int number_of_elements, int number_of_instances)
+{
+	// add command
+	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::DRAW);
+
+	// copy args
+	command.draw.base_element = base_element;
+	command.draw.number_of_elements = number_of_elements;
+	command.draw.number_of_instances = number_of_instances;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::add_command_draw_culled(const RENDER_BOUNDS& bounds, int base_element, int number_of_elements, int number_of_instances)
+{
+	// add draw
+	add_command_draw(base_element, number_of_elements, number_of_instances);
+
+	// no frustum?
+	if (!m_number_of_cull_frustums)
+	{
+		return;
+	}
+
+	// add bounds to current frustum
+	CULL_FRUSTUM& frustum = m_cull_frustums[m_number_of_cull_frustums - 1];
+	frustum.center_x.push_back(bounds.center[0]);
+	frustum.center_y.push_back(bounds.center[1]);
+	frustum.center_z.push_back(bounds.center[2]);
+	frustum.extents_x.push_back(bounds.extents[0]);
+	frustum.extents_y.push_back(bounds.extents[1]);
+	frustum.extents_z.push_back(bounds.extents[2]);
+	frustum.radius.push_back(bounds.radius);
+	frustum.commands.push_back((uint32_t)m_commands[m_pending_commands_index].size() - 1);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::add_commands_draw_batch(const RENDER_DRAW* draws, size_t number_of_draws)
+{
+	// nothing to draw?
+	if (!number_of_draws)
+	{
+		return;
+	}
+
+	// start timing
+	auto start_time = std::chrono::steady_clock::now();
+
+	// commands grow like the add_command_xxx() calls, reserving the worst case of four per record would commit far more than most batches use
+	RENDER_COMMAND_ARRAY& commands = m_commands[m_pending_commands_index];
+
+	// initialise state, the first record always applies its pipeline and bindings
+	uint32_t pipeline = SG_INVALID_ID;
+	uint32_t binding_set = 0;
+	const sg_bindings* bindings = nullptr;
+	const RENDER_DRAW* uniforms = nullptr;
+
+	// loop through draws
+	for (size_t i = 0; i < number_of_draws; i ++)
+	{
+		const RENDER_DRAW& draw = draws[i];
+
+		// destroyed binding set or uniforms too big for a command? skip the draw rather than use whatever was bound before
+		if ((draw.binding_set && !is_binding_set(draw.binding_set)) || (size_t)draw.uniforms.size > sizeof(RENDER_COMMAND::apply_uniforms.buf))
+		{
+			m_frame_stats.number_of_skipped_draws ++;
+			continue;
+		}
+
+		// apply pipeline, sokol needs bindings and uniforms to be applied again after it
+		if (draw.pipeline.id != pipeline)
+		{
+			RENDER_COMMAND& command = commands.emplace_back(RENDER_COMMAND::TYPE::APPLY_PIPELINE);
+			command.apply_pipeline.pipeline = draw.pipeline;
+			pipeline = draw.pipeline.id;
+			binding_set = 0;
+			bindings = nullptr;
+			uniforms = nullptr;
+		}
+
+		// apply binding set
+		if (draw.binding_set)
+		{
+			if (draw.binding_set != binding_set)
+			{
+				if (m_ring)
+				{
+					RENDER_COMMAND& command = commands.emplace_back(RENDER_COMMAND::TYPE::APPLY_BINDINGS);
+					command.apply_bindings.bindings = get_binding_set(draw.binding_set);
+				}
+				else
+				{
+					RENDER_COMMAND& command = commands.emplace_back(RENDER_COMMAND::TYPE::APPLY_BINDING_SET);
+					command.apply_binding_set.binding_set = draw.binding_set;
+					command.apply_binding_set.offsets = false;
+				}
+				binding_set = draw.binding_set;
+				bindings = nullptr;
+			}
+		}
+		else if (draw.bindings && draw.bindings != bindings)
+		{
+			// apply bindings
+			RENDER_COMMAND& command = commands.emplace_back(RENDER_COMMAND::TYPE::APPLY_BINDINGS);
+			command.apply_bindings.bindings = *draw.bindings;
+			binding_set = 0;
+			bindings = draw.bindings;
+		}
+
+		// apply uniforms
+		bool same_uniforms = uniforms && uniforms->uniforms.ptr == draw.uniforms.ptr && uniforms->uniforms.size == draw.uniforms.size && uniforms->uniform_stage == draw.uniform_stage && uniforms->uniform_block == draw.uniform_block;
+		if (draw.uniforms.size && !same_uniforms)
+		{
+			RENDER_COMMAND& command = commands.emplace_back(RENDER_COMMAND::TYPE::APPLY_UNIFORMS);
+			command.apply_uniforms.stage = draw.uniform_stage;
+			command.apply_uniforms.ub_index = draw.uniform_block;
+			memcpy(command.apply_uniforms.buf, draw.uniforms.ptr, draw.uniforms.size);
+			command.apply_uniforms.data_size = draw.uniforms.size;
+			uniforms = &draw;
+		}
+
+		// draw
+		RENDER_COMMAND& command = commands.emplace_back(RENDER_COMMAND::TYPE::DRAW);
+		command.draw.base_element = draw.base_element;
+		command.draw.number_of_elements = draw.number_of_elements;
+		command.draw.number_of_instances = draw.number_of_instances;
+	}
+
+	// update stats
+	m_frame_stats.number_of_draw_batches ++;
+	m_frame_stats.number_of_batched_draws += (uint32_t)number_of_draws;
+	m_frame_stats.batch_time += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::add_command_end_pass()
+{
+	// add command
+	/*RENDER_COMMAND& command = */m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::END_PASS);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::add_command_commit()
+{
+	// add command
+	/*RENDER_COMMAND& command = */m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::COMMIT);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::add_command_custom(void (*custom_cb)(void* custom_data), void* custom_data)
+{
+	// add command
+	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::CUSTOM);
+
+	// copy args
+	command.custom.custom_cb = custom_cb;
+	command.custom.custom_data = custom_data;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::set_cull_frustum(const float planes[6][4])
+{
+	// get frustum, recycling the bounds arrays of earlier frames
+	if (m_number_of_cull_frustums == (int32_t)m_cull_frustums.size())
+	{
+		m_cull_frustums.emplace_back();
+	}
+	CULL_FRUSTUM& frustum = m_cull_frustums[m_number_of_cull_frustums ++];
+
+	// loop through planes
+	for (int32_t p = 0; p < 6; p ++)
+	{
+		// normalise plane so distances are comparable with radius and extents
+		float length = sqrtf(planes[p][0] * planes[p][0] + planes[p][1] * planes[p][1] + planes[p][2] * planes[p][2]);
+		float scale = length > 0.0f ? 1.0f / length : 0.0f;
+		for (int32_t i = 0; i < 4; i ++)
+		{
+			frustum.planes[p][i] = planes[p][i] * scale;
+		}
+		for (int32_t i = 0; i < 3; i ++)
+		{
+			frustum.abs_normals[p][i] = fabsf(frustum.planes[p][i]);
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::enable_dynamic_resolution(const RENDER_RESOLUTION_DESC& desc)
+{
+	// copy desc
+	m_resolution_desc = desc;
+
+	// start at the largest scale and measure from the next executed frame
+	m_dynamic_resolution = true;
+	m_resolution_scale = std::min(std::max(1.0f, desc.min_scale), desc.max_scale);
+	m_smoothed_execute_time = 0.0;
+	m_resolution_step_time = 0.0;
+	m_resolution_floor = 0.0f;
+	m_number_of_resolution_frames = 0;
+	m_resolution_frame_index = get_executed_frame_index();
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::disable_dynamic_resolution()
+{
+	// back to full resolution
+	m_dynamic_resolution = false;
+	m_resolution_scale = 1.0f;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::update_resolution_scale()
+{
+	// disabled, or remote? the host measures execute time in its own process
+	if (!m_dynamic_resolution || m_ring)
+	{
+		return;
+	}
+
+	// no frame executed since the last update, or since the scale changed?
+	int32_t executed_frame_index = get_executed_frame_index();
+	if (executed_frame_index <= m_resolution_frame_index)
+	{
+		return;
+	}
+	m_resolution_frame_index = executed_frame_index;
+
+	// smooth execute time
+	double execute_time = m_execute_time.load(std::memory_order_relaxed);
+	m_smoothed_execute_time = m_smoothed_execute_time > 0.0 ? m_smoothed_execute_time + (execute_time - m_smoothed_execute_time) * RESOLUTION_SMOOTHING : execute_time;
+
+	// count frames over (positive) or under (negative) the budget, outside the hysteresis band
+	const double budget = m_resolution_desc.frame_budget;
+	if (m_smoothed_execute_time > budget * (1.0 + m_resolution_desc.hysteresis))
+	{
+		m_number_of_resolution_frames = std::max(m_number_of_resolution_frames, 0) + 1;
+	}
+	else if (m_smoothed_execute_time < budget * (1.0 - m_resolution_desc.hysteresis))
+	{
+		// under budget, so lowering may help again if the frame gets heavier
+		m_resolution_floor = 0.0f;
+		m_number_of_resolution_frames = m_resolution_scale < m_resolution_desc.max_scale ? std::min(m_number_of_resolution_frames, 0) - 1 : 0;
+	}
+	else
+	{
+		m_number_of_resolution_frames = 0;
+	}
+
+	// not over or under for long enough?
+	if (m_smoothed_execute_time <= 0.0 || std::abs(m_number_of_resolution_frames) < std::max(m_resolution_desc.number_of_frames, 1))
+	{
+		return;
+	}
+
+	// last step down didn't cut the measured time? the frame isn't limited by resolution, so go back and stop lowering until it's under budget again
+	const bool over = m_number_of_resolution_frames > 0;
+	if (over && m_resolution_step_time > 0.0 && m_smoothed_execute_time > m_resolution_step_time * (1.0 - m_resolution_desc.hysteresis * 0.5))
+	{
+		m_resolution_floor = m_resolution_step_scale;
+		set_resolution_scale(m_resolution_step_scale, 0.0);
+		return;
+	}
+
+	// already at the lowest scale that helped?
+	if (over && m_resolution_scale <= m_resolution_floor)
+	{
+		m_number_of_resolution_frames = 0;
+		return;
+	}
+
+	// scale pixel count by how far off the budget the time is, rounded to a step but always moving at least one
+	float scale = m_resolution_scale * sqrtf((float)(budget / m_smoothed_execute_time));
+	if (m_resolution_desc.step > 0.0f)
+	{
+		scale = roundf(scale / m_resolution_desc.step) * m_resolution_desc.step;
+		if (over ? scale >= m_resolution_scale : scale <= m_resolution_scale)
+		{
+			scale = m_resolution_scale + (over ? -m_resolution_desc.step : m_resolution_desc.step);
+		}
+	}
+	scale = fabsf(scale - 1.0f) < 1e-4f ? 1.0f : scale;
+	scale = std::min(std::max(scale, std::max(m_resolution_desc.min_scale, m_resolution_floor)), m_resolution_desc.max_scale);
+
+	// set scale, remembering the time before a step down so the next update can check it helped
+	set_resolution_scale(scale, over ? m_smoothed_execute_time : 0.0);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::set_resolution_scale(float scale, double step_time)
+{
+	// remember scale and time before the step
+	m_resolution_step_scale = m_resolution_scale;
+	m_resolution_step_time = step_time;
+	m_resolution_scale = scale;
+
+	// measure again from the first frame recorded at the new scale, rather than predicting the time there
+	m_smoothed_execute_time = 0.0;
+	m_number_of_resolution_frames = 0;
+	m_resolution_frame_index = m_frame_index - 1;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::schedule_cleanup(void (*cleanup_cb)(void* cleanup_data), void* cleanup_data, int32_t number_of_frames_to_defer)
+{
+	// add cleanup
+	RENDER_CLEANUP& cleanup = m_cleanups.emplace_back(cleanup_cb, cleanup_data);
+	
+	// set frame index
+	cleanup.frame_index = m_frame_index + 1 + number_of_frames_to_defer;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::schedule_synchronous_cleanup(void (*cleanup_cb)(void* cleanup_data), void* cleanup_data)
+{
+	// schedule cleanup
+	schedule_cleanup(cleanup_cb, cleanup_data);
+
+	// always call from the update thread, sokol's resource pools aren't thread safe
+	m_cleanups.back().synchronous = true;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::start_cleanup_thread()
+{
+	// already started?
+	if (m_cleanup_thread.joinable())
+	{
+		return;
+	}
+
+	// start cleanup thread
+	m_stop_cleanup_thread = false;
+	m_cleanup_thread = std::thread(&RENDERER::cleanup_thread_loop, this);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::stop_cleanup_thread()
+{
+	// wait for dispatched cleanups
+	wait_for_cleanups();
+
+	// started?
+	if (m_cleanup_thread.joinable())
+	{
+		// signal cleanup thread to exit
+		{
+			std::lock_guard<std::mutex> lock(m_cleanup_mutex);
+			m_stop_cleanup_thread = true;
+		}
+		m_cleanup_cv.notify_one();
+
+		// wait for cleanup thread to exit
+		m_cleanup_thread.join();
+	}
+
+	// delete free batches
+	for (auto batch : m_free_cleanup_batches)
+	{
+		delete batch;
+	}
+	m_free_cleanup_batches.clear();
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::set_cleanup_dispatch_cb(void (*dispatch_cb)(void (*run_cb)(void* run_data), void* run_data, void* user_data), void* user_data)
+{
+	// wait for cleanups dispatched to the previous executor
+	wait_for_cleanups();
+
+	// copy args
+	m_cleanup_dispatch_cb = dispatch_cb;
+	m_cleanup_dispatch_user_data = user_data;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::wait_for_cleanups()
+{
+	// wait for dispatched batches to finish
+	std::unique_lock<std::mutex> lock(m_cleanup_mutex);
+	m_cleanup_done_cv.wait(lock, [this]() { return m_number_of_pending_cleanup_batches == 0; });
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::submit_texture_job(sg_image image, bool make, const RENDER_TEXTURE_DESC& desc)
+{
+	// create job
+	TEXTURE_JOB* job = new TEXTURE_JOB();
+	job->renderer = this;
+	job->desc = desc;
+	job->image = image;
+	job->make = make;
+	job->reset_count = m_reset_count;
+	job->number_of_mipmaps = desc.generate_mipmaps ? TEXTURE_PREP::get_number_of_mipmaps(desc.width, desc.height) : 1;
+
+	// queue behind earlier jobs for the image, their commands are added in the order the jobs were submitted
+	m_texture_jobs[image.id].jobs.push_back(job);
+
+	// prepare on a worker thread, or right away if there aren't any
+	m_worker_pool.submit(run_texture_job, job);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::run_texture_job(void* job_data)
+{
+	// get job
+	TEXTURE_JOB* job = (TEXTURE_JOB*)job_data;
+	const RENDER_TEXTURE_DESC& desc = job->desc;
+
+	// convert and mipmap into one allocation
+	job->data = malloc(TEXTURE_PREP::get_size(desc.pixel_format, desc.width, desc.height, job->number_of_mipmaps));
+	if (job->data && !TEXTURE_PREP::prepare(desc.data, desc.source_pixel_format, desc.width, desc.height, desc.pixel_format, job->number_of_mipmaps, job->data, job->image_data.subimage[0]))
+	{
+		free(job->data);
+		job->data = nullptr;
+	}
+
+	// hand job back to the update thread
+	std::scoped_lock<std::mutex> lock(job->renderer->m_texture_mutex);
+	job->renderer->m_finished_texture_jobs.push_back(job);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::add_texture_job_commands()
+{
+	// lock texture mutex
+	std::scoped_lock<std::mutex> lock(m_texture_mutex);
+
+	// nothing finished?
+	if (m_finished_texture_jobs.empty())
+	{
+		return;
+	}
+
+	// mark finished jobs, jobs can finish out of order so they're added from the image queues
+	std::vector<uint32_t> images;
+	for (TEXTURE_JOB* job : m_finished_texture_jobs)
+	{
+		job->finished = true;
+		images.push_back(job->image.id);
+	}
+	m_finished_texture_jobs.clear();
+
+	// loop through images with finished jobs
+	for (uint32_t id : images)
+	{
+		// already added?
+		auto it = m_texture_jobs.find(id);
+		if (it == m_texture_jobs.end())
+		{
+			continue;
+		}
+
+		// add jobs in the order they were submitted, until one that's still being prepared
+		TEXTURE_IMAGE_JOBS& image_jobs = it->second;
+		while (!image_jobs.jobs.empty() && image_jobs.jobs.front()->finished)
+		{
+			add_texture_job_command(image_jobs.jobs.front(), image_jobs.destroy);
+			image_jobs.jobs.pop_front();
+		}
+
+		// still being prepared?
+		if (!image_jobs.jobs.empty())
+		{
+			continue;
+		}
+
+		// destroy image, once its last job has been added
+		bool destroy = image_jobs.destroy;
+		m_texture_jobs.erase(it);
+		if (destroy)
+		{
+			add_command_destroy_image({ id });
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::add_texture_job_command(TEXTURE_JOB* job, bool destroyed)
+{
+	// image destroyed by reset()?
+	if (job->reset_count != m_reset_count)
+	{
+		free(job->data);
+		job->data = nullptr;
+	}
+
+	// make image, without data if preparing failed so the image ends up failed rather than stuck allocated
+	if (job->make && job->reset_count == m_reset_count)
+	{
+		RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::MAKE_IMAGE);
+		command.make_image.desc = job->desc.image_desc;
+		command.make_image.desc.width = job->desc.width;
+		command.make_image.desc.height = job->desc.height;
+		command.make_image.desc.pixel_format = job->desc.pixel_format;
+		command.make_image.desc.num_mipmaps = job->number_of_mipmaps;
+		command.make_image.desc.data = job->image_data;
+		command.make_image.image = job->image;
+	}
+
+	// update image, unless it's about to be destroyed?
+	else if (job->data && !destroyed)
+	{
+		RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::UPDATE_IMAGE);
+		command.update_image.image = job->image;
+		command.update_image.data = job->image_data;
+	}
+
+	// free pixels once the frame has executed
+	if (job->data)
+	{
+		schedule_cleanup(free, job->data);
+	}
+
+	// release source
+	if (job->desc.cleanup_cb)
+	{
+		job->desc.cleanup_cb(job->desc.cleanup_data);
+	}
+
+	// delete job
+	delete job;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::destroy_texture_jobs()
+{
+	// stop worker threads, once they have drained the queued jobs
+	m_worker_pool.stop();
+
+	// loop through images, every job has finished now and is still queued on its image until its commands are added
+	std::scoped_lock<std::mutex> lock(m_texture_mutex);
+	for (auto& image_jobs : m_texture_jobs)
+	{
+		for (TEXTURE_JOB* job : image_jobs.second.jobs)
+		{
+			// free pixels
+			free(job->data);
+
+			// release source
+			if (job->desc.cleanup_cb)
+			{
+				job->desc.cleanup_cb(job->desc.cleanup_data);
+			}
+
+			// delete job
+			delete job;
+		}
+	}
+	m_texture_jobs.clear();
+	m_finished_texture_jobs.clear();
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void* RENDERER::alloc_frame_data(size_t size)
+{
+	// remote?
+	if (m_ring)
+	{
+		// allocate from the shared upload heap so the data isn't copied into the ring
+		void* ptr = m_ring->alloc_upload(size, m_frame_index);
+		if (ptr)
+		{
+			return ptr;
+		}
+	}
+
+	// allocate data
+	void* ptr = malloc(size);
+
+	// free once the frame has executed
+	schedule_cleanup(free, ptr);
+
+	// return data
+	return ptr;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::commit_commands()
+{
+	// end record trace, begin commit trace
+	trace_end(TRACE::THREAD::UPDATE);
+	trace_begin(TRACE::THREAD::UPDATE, "commit_commands");
+
+	// cull draws
+	cull_commands(true);
+
+	// optimize commands
+	if (m_optimize_commands || m_strip_debug_groups)
+	{
+		optimize_commands(m_commands[m_pending_commands_index]);
+	}
+
+	// remote? write commands to ring before publishing stats so they count the commands this frame dropped, blocks while the ring is full
+	if (m_ring)
+	{
+		m_frame_stats.number_of_dropped_commands += (uint32_t)write_ring_commands(false, true);
+	}
+
+	// publish stats
+	m_frame_stats.number_of_binding_sets = m_number_of_live_binding_sets;
+	m_frame_stats.execute_time = m_execute_time.load(std::memory_order_relaxed);
+	m_frame_stats.resolution_scale = m_resolution_scale;
+	m_stats = m_frame_stats;
+	m_frame_stats = {};
+
+	// remote?
+	if (m_ring)
+	{
+		// process cleanups for the frames the host has executed
+		process_cleanups(m_ring->get_executed_frame_index() + 1);
+
+		// increase frame index
+		m_frame_index ++;
+
+		// add commands for images prepared since the last commit
+		add_texture_job_commands();
+
+		// update scale for the next frame
+		update_resolution_scale();
+
+		// end commit trace, begin record trace
+		trace_end(TRACE::THREAD::UPDATE);
+		trace_begin(TRACE::THREAD::UPDATE, "record");
+		return;
+	}
+
+	// not already handed over by submit_partial()?
+	if (!m_partial_frame)
+	{
+		// acquire render semaphore
+		trace_begin(TRACE::THREAD::UPDATE, "wait_for_execute");
+		m_render_semaphore.acquire();
+		trace_end(TRACE::THREAD::UPDATE);
+		
+		// clear commands
+		m_commands[m_commit_commands_index].resize(0);
+
+		// set frame index for the render thread to publish once executed
+		m_commit_frame_index = m_frame_index;
+	}
+
+	// process cleanups
+	process_cleanups(m_frame_index);
+	
+	// swap commands indexes
+	std::swap(m_pending_commands_index, m_commit_commands_index);
+
+	// increase frame index
+	m_frame_index ++;
+
+	// partial frame?
+	if (m_partial_frame)
+	{
+		// close partial frame, the render thread executes the remaining commands once it has run out of chunks
+		{
+			std::scoped_lock<std::mutex> lock(m_partial_mutex);
+			m_partial_frame_open = false;
+		}
+		m_partial_cv.notify_one();
+		m_partial_frame = false;
+	}
+	else
+	{
+		// release update semaphore
+		m_update_semaphore.release();
+	}
+
+	// add commands for images prepared since the last commit, they execute at the start of the next frame
+	add_texture_job_commands();
+
+	// update scale for the next frame
+	update_resolution_scale();
+
+	// end commit trace, begin record trace
+	trace_end(TRACE::THREAD::UPDATE);
+	trace_begin(TRACE::THREAD::UPDATE, "record");
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::submit_partial()
+{
+	// begin trace
+	trace_begin(TRACE::THREAD::UPDATE, "submit_partial");
+
+	// cull draws
+	cull_commands(false);
+
+	// optimize commands
+	if (m_optimize_commands || m_strip_debug_groups)
+	{
+		optimize_commands(m_commands[m_pending_commands_index]);
+	}
+
+	// remote?
+	if (m_ring)
+	{
+		// write commands to ring without ending the frame, the host executes packets as they arrive
+		m_frame_stats.number_of_dropped_commands += (uint32_t)write_ring_commands(false, false);
+
+		// end trace
+		trace_end(TRACE::THREAD::UPDATE);
+		return;
+	}
+
+	// first submit of the frame?
+	if (!m_partial_frame)
+	{
+		// acquire render semaphore
+		trace_begin(TRACE::THREAD::UPDATE, "wait_for_execute");
+		m_render_semaphore.acquire();
+		trace_end(TRACE::THREAD::UPDATE);
+
+		// clear commands
+		m_commands[m_commit_commands_index].resize(0);
+
+		// set frame index for the render thread to publish once executed
+		m_commit_frame_index = m_frame_index;
+
+		// open partial frame
+		{
+			std::scoped_lock<std::mutex> lock(m_partial_mutex);
+			m_partial_frame_open = true;
+		}
+		m_partial_frame = true;
+
+		// release update semaphore, the render thread starts the frame and waits for chunks
+		m_update_semaphore.release();
+	}
+
+	// get recycled chunk
+	RENDER_COMMAND_ARRAY chunk;
+	{
+		std::scoped_lock<std::mutex> lock(m_partial_mutex);
+		if (!m_free_partial_chunks.empty())
+		{
+			chunk = std::move(m_free_partial_chunks.back());
+			m_free_partial_chunks.pop_back();
+		}
+	}
+
+	// swap pending commands into chunk
+	std::swap(chunk, m_commands[m_pending_commands_index]);
+	if (m_commands[m_pending_commands_index].capacity() < INITIAL_NUMBER_OF_COMMANDS)
+	{
+		m_commands[m_pending_commands_index].reserve(INITIAL_NUMBER_OF_COMMANDS);
+	}
+
+	// publish chunk
+	{
+		std::scoped_lock<std::mutex> lock(m_partial_mutex);
+		m_partial_chunks.push_back(std::move(chunk));
+	}
+	m_partial_cv.notify_one();
+
+	// end trace
+	trace_end(TRACE::THREAD::UPDATE);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::flush_commands()
+{
+	// set teardown start time
+	m_teardown_start_time = std::chrono::steady_clock::now();
+
+	// finish partial frame first
+	if (m_partial_frame)
+	{
+		commit_commands();
+	}
+
+	// end record trace, begin flush trace
+	trace_end(TRACE::THREAD::UPDATE);
+	trace_begin(TRACE::THREAD::UPDATE, "flush_commands");
+
+	// remote?
+	if (m_ring)
+	{
+		// write commands to ring
+		write_ring_commands(true, true);
+
+		// set flushing
+		m_flushing = true;
+
+		// end flush trace
+		trace_end(TRACE::THREAD::UPDATE);
+		return;
+	}
+
+	// acquire render semaphore
+	m_render_semaphore.acquire();
+	
+	// clear commands
+	m_commands[m_commit_commands_index].resize(0);
+
+	// set frame index for the render thread to publish once executed
+	m_commit_frame_index = m_frame_index;
+	
+	// swap commands indexes
+	std::swap(m_pending_commands_index, m_commit_commands_index);
+
+	// set flushing
+	m_flushing = true;
+
+	// release update semaphore
+	m_update_semaphore.release();
+
+	// end flush trace
+	trace_end(TRACE::THREAD::UPDATE);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::reset()
+{
+	// begin trace
+	trace_begin(TRACE::THREAD::UPDATE, "reset");
+	m_teardown_start_time = std::chrono::steady_clock::now();
+
+	// destroys are redundant as everything is destroyed anyway
+	for (auto& command : m_commands[m_pending_commands_index])
+	{
+		if (command.type >= RENDER_COMMAND::TYPE::DESTROY_BUFFER && command.type <= RENDER_COMMAND::TYPE::DESTROY_PASS)
+		{
+			command.type = RENDER_COMMAND::TYPE::NOT_SET;
+		}
+	}
+
+	// add reset command, everything recorded so far executes first
+	m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::RESET);
+
+	// drop handle deallocations, the handles may be reused by the new pools
+	m_cleanups.erase(std::remove_if(m_cleanups.begin(), m_cleanups.end(), [](const auto& cleanup) { return cleanup.synchronous; }), m_cleanups.end());
+
+	// forget prewarmed objects, they are destroyed too
+	{
+		std::scoped_lock<std::mutex> lock(m_prewarm_mutex);
+		m_prewarm_queue.clear();
+		m_prewarm_lookup.clear();
+	}
+	m_manifest_shader_hashes.clear();
+
+	// images still being prepared are discarded, and not destroyed again once they're ready
+	m_reset_count ++;
+	for (auto& image_jobs : m_texture_jobs)
+	{
+		image_jobs.second.destroy = false;
+	}
+
+	// commit and wait for the render thread to execute the reset, new handles must come from the new pools
+	int32_t fence = get_current_frame_fence();
+	commit_commands();
+	wait_for_fence(fence);
+
+	// a remote host forgets client handles too, so they start again
+	if (m_ring)
+	{
+		memset(m_ring_handle_counters, 0, sizeof(m_ring_handle_counters));
+		for (auto& free_handles : m_ring_free_handles)
+		{
+			free_handles.clear();
+		}
+	}
+
+	// publish teardown time
+	publish_teardown_time();
+
+	// end trace
+	trace_end(TRACE::THREAD::UPDATE);
 }
 
 // ----------------------------------------------------------------------------------------------------
 
-void RENDERER::add_command_update_buffer(sg_buffer buffer, const sg_range& data)
+const std::string RENDERER::get_name() const
 {
-	// add command
-	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::UPDATE_BUFFER);
+	// return name
+	switch (sg_query_backend())
+	{
+	case SG_BACKEND_GLCORE33:
+		return "OpenGL 3.3";
+	case SG_BACKEND_GLES2:
+		return "OpenGL ES 2.0";
+	case SG_BACKEND_GLES3:
+		return "OpenGL ES 3.0";
+	case SG_BACKEND_D3D11:
+		return "Direct3D 11";
+	case SG_BACKEND_METAL_IOS:
+	case SG_BACKEND_METAL_MACOS:
+	case SG_BACKEND_METAL_SIMULATOR:
+		return "Metal";
+	case SG_BACKEND_WGPU:
+		return "WebGPU";
+	default:
+		return "Unknown";
+	}
+}
 
-	// copy args
-	command.update_buffer.buffer = buffer;
-	command.update_buffer.data = data;
+// ----------------------------------------------------------------------------------------------------
+
+void RENDERER::enable_trace(uint32_t number_of_events_per_thread)
+{
+	// no trace?
+	TRACE* trace = m_trace.load();
+	if (!trace)
+	{
+		// create trace
+		TRACE* new_trace = new TRACE(number_of_events_per_thread);
+
+		// publish trace, or use the one published by another thread
+		if (m_trace.compare_exchange_strong(trace, new_trace))
+		{
+			trace = new_trace;
+		}
+		else
+		{
+			delete new_trace;
+		}
+	}
+
+	// enable trace
+	trace->set_enabled(true);
 }
 
 // ----------------------------------------------------------------------------------------------------
 
-void RENDERER::add_command_append_buffer(sg_buffer buffer, const sg_range& data)
+void RENDERER::disable_trace()
 {
-	// add command
-	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::APPEND_BUFFER);
+	// disable trace, the rings are kept so they can still be written out
+	TRACE* trace = m_trace.load();
+	if (trace)
+	{
+		trace->set_enabled(false);
+	}
+}
 
-	// copy args
-	command.append_buffer.buffer = buffer;
-	command.append_buffer.data = data;
+// ----------------------------------------------------------------------------------------------------
+
+bool RENDERER::save_pipeline_manifest(const char* filename) const
+{
+	// open file
+	FILE* file = fopen(filename, "wb");
+
+	// failed?
+	if (!file)
+	{
+		return false;
+	}
+
+	// write header
+	MANIFEST_HEADER header = { MANIFEST_MAGIC, MANIFEST_VERSION, (uint32_t)sizeof(sg_shader_desc), (uint32_t)sizeof(sg_pipeline_desc), (uint32_t)m_manifest_entries.size(), 0 };
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+
+	// loop through entries, shaders are always recorded before the pipelines using them
+	for (const auto& entry : m_manifest_entries)
+	{
+		// write entry
+		MANIFEST_ENTRY_HEADER entry_header = { (uint32_t)entry.type, (uint32_t)entry.data.size(), entry.hash, entry.shader_hash };
+		written = written && fwrite(&entry_header, sizeof(entry_header), 1, file) == 1;
+		written = written && fwrite(entry.data.data(), 1, entry.data.size(), file) == entry.data.size();
+	}
+
+	// close file
+	return fclose(file) == 0 && written;
 }
 
 // ----------------------------------------------------------------------------------------------------
 
-void RENDERER::add_command_update_image(sg_image image, const sg_image_data& data)
+bool RENDERER::load_pipeline_manifest(const char* filename)
 {
-	// add command
-	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::UPDATE_IMAGE);
+	// remote? objects can only be prewarmed in the host process
+	if (m_ring)
+	{
+		return false;
+	}
+
+	// sokol graphics not setup yet? prewarmed objects are built with the handles reserved here
+	if (!m_setup_complete.load(std::memory_order_acquire))
+	{
+		return false;
+	}
+
+	// open file
+	FILE* file = fopen(filename, "rb");
+
+	// failed?
+	if (!file)
+	{
+		return false;
+	}
+
+	// read header, manifests written by a different sokol build are ignored
+	MANIFEST_HEADER header = {};
+	if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != MANIFEST_MAGIC || header.version != MANIFEST_VERSION || header.shader_desc_size != sizeof(sg_shader_desc) || header.pipeline_desc_size != sizeof(sg_pipeline_desc))
+	{
+		fclose(file);
+		return false;
+	}
+
+	// loop through entries
+	for (uint32_t i = 0; i < header.number_of_entries; i ++)
+	{
+		// read entry header
+		MANIFEST_ENTRY_HEADER entry_header = {};
+		if (fread(&entry_header, sizeof(entry_header), 1, file) != 1 || entry_header.size > MAX_MANIFEST_ENTRY_SIZE)
+		{
+			break;
+		}
+
+		// read entry data
+		auto entry = std::make_unique<PREWARM_ENTRY>();
+		entry->type = (RESOURCE_TYPE::ENUM)entry_header.type;
+		entry->data.resize(entry_header.size);
+		if (fread(entry->data.data(), 1, entry->data.size(), file) != entry->data.size())
+		{
+			break;
+		}
+
+		// unknown type or already loaded?
+		if ((entry->type != RESOURCE_TYPE::SHADER && entry->type != RESOURCE_TYPE::PIPELINE) || m_prewarm_lookup.count(entry_header.hash))
+		{
+			continue;
+		}
+
+		// fix up desc pointers
+		RENDER_COMMAND command(entry->type == RESOURCE_TYPE::SHADER ? RENDER_COMMAND::TYPE::MAKE_SHADER : RENDER_COMMAND::TYPE::MAKE_PIPELINE);
+		if (!deserialize_manifest_desc(command, entry->data))
+		{
+			continue;
+		}
+
+		// pipeline?
+		if (entry->type == RESOURCE_TYPE::PIPELINE)
+		{
+			// find shader, pipelines whose shader isn't prewarmed are skipped
+			auto it = m_prewarm_lookup.find(entry_header.shader_hash);
+			if (it == m_prewarm_lookup.end() || it->second->type != RESOURCE_TYPE::SHADER)
+			{
+				continue;
+			}
+
+			// set shader, reserve pipeline
+			((sg_pipeline_desc*)entry->data.data())->shader.id = it->second->id;
+			entry->id = alloc_pipeline().id;
+		}
+		else
+		{
+			// reserve shader
+			entry->id = alloc_shader().id;
+		}
+
+		// add entry
+		m_prewarm_lookup[entry_header.hash] = entry.get();
+		{
+			std::lock_guard<std::mutex> lock(m_prewarm_mutex);
+			m_prewarm_queue.push_back(entry.get());
+		}
+		m_prewarm_entries.push_back(std::move(entry));
+	}
+
+	// close file
+	fclose(file);
+	return true;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+bool RENDERER::execute_prewarm(int32_t number_of_objects)
+{
+	// build objects
+	for (int32_t i = 0; i < number_of_objects; i ++)
+	{
+		if (!build_prewarm_entry())
+		{
+			return false;
+		}
+	}
+
+	// return whether there's more to build
+	std::lock_guard<std::mutex> lock(m_prewarm_mutex);
+	return !m_prewarm_queue.empty();
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+uint64_t RENDERER::record_manifest_command(RENDER_COMMAND& command, uint64_t shader_hash)
+{
+	// serialize desc
+	serialize_manifest_desc(command, m_manifest_scratch);
+
+	// hash desc, pipelines include the hash of their shader instead of its handle
+	uint64_t hash = hash_bytes(&command.type, sizeof(command.type));
+	hash = hash_bytes(&shader_hash, sizeof(shader_hash), hash);
+	hash = hash_bytes(m_manifest_scratch.data(), m_manifest_scratch.size(), hash);
+
+	// record new desc?
+	if (m_record_manifest && m_manifest_hashes.insert(hash).second)
+	{
+		MANIFEST_ENTRY& entry = m_manifest_entries.emplace_back();
+		entry.type = command.type == RENDER_COMMAND::TYPE::MAKE_SHADER ? RESOURCE_TYPE::SHADER : RESOURCE_TYPE::PIPELINE;
+		entry.hash = hash;
+		entry.shader_hash = shader_hash;
+		entry.data = m_manifest_scratch;
+	}
+
+	// return hash
+	return hash;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+uint32_t RENDERER::claim_prewarm_entry(uint64_t hash, uint32_t shader_id, bool& built)
+{
+	// not prewarmed?
+	auto it = m_prewarm_lookup.find(hash);
+	if (it == m_prewarm_lookup.end())
+	{
+		return SG_INVALID_ID;
+	}
+
+	// pipeline prewarmed with a different shader object?
+	PREWARM_ENTRY* entry = it->second;
+	if (entry->type == RESOURCE_TYPE::PIPELINE && ((const sg_pipeline_desc*)entry->data.data())->shader.id != shader_id)
+	{
+		return SG_INVALID_ID;
+	}
+
+	// claim entry, anything the render thread has started building is finished before it executes the next frame
+	m_prewarm_lookup.erase(it);
+	built = entry->state.exchange(PREWARM_STATE::CLAIMED, std::memory_order_acq_rel) != PREWARM_STATE::RESERVED;
+
+	// return handle
+	return entry->id;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+bool RENDERER::build_prewarm_entry()
+{
+	// pop entry
+	PREWARM_ENTRY* entry = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(m_prewarm_mutex);
+		if (m_prewarm_queue.empty())
+		{
+			return false;
+		}
+		entry = m_prewarm_queue.front();
+		m_prewarm_queue.pop_front();
+	}
+
+	// lock execute mutex
+	std::lock_guard<std::mutex> lock(m_execute_mutex);
+
+	// pipeline whose shader isn't built (e.g. claimed before it was prewarmed)? it gets made when first requested
+	if (entry->type == RESOURCE_TYPE::PIPELINE && sg_query_shader_state(((const sg_pipeline_desc*)entry->data.data())->shader) != SG_RESOURCESTATE_VALID)
+	{
+		return true;
+	}
+
+	// already claimed by the update thread?
+	int32_t state = PREWARM_STATE::RESERVED;
+	if (!entry->state.compare_exchange_strong(state, PREWARM_STATE::BUILDING, std::memory_order_acq_rel))
+	{
+		return true;
+	}
+
+	// build object
+	trace_begin(TRACE::THREAD::RENDER, "prewarm");
+	if (entry->type == RESOURCE_TYPE::SHADER)
+	{
+		sg_init_shader({ entry->id }, *(const sg_shader_desc*)entry->data.data());
+	}
+	else
+	{
+		sg_init_pipeline({ entry->id }, *(const sg_pipeline_desc*)entry->data.data());
+	}
+	trace_end(TRACE::THREAD::RENDER);
+
+	// set built
+	entry->state.store(PREWARM_STATE::BUILT, std::memory_order_release);
+	return true;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+bool RENDERER::write_trace(const char* filename) const
+{
+	// no trace?
+	TRACE* trace = m_trace.load();
+	if (!trace)
+	{
+		return false;
+	}
+
+	// write trace
+	return trace->write(filename);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+size_t RENDERER::write_ring_commands(bool flush, bool end_of_frame)
+{
+	// get commands
+	RENDER_COMMAND_ARRAY& commands = m_commands[m_pending_commands_index];
+	size_t number_of_dropped_commands = 0;
+
+	// keep packets small enough that the host can read one while the next is written
+	size_t max_packet_size = std::min(MAX_RING_PACKET_SIZE, m_ring->get_capacity() / 2);
+
+	// loop through packets, always writing at least one so the host sees the end of the frame
+	size_t begin = 0;
+	do
+	{
+		// gather commands that fit in the packet
+		size_t end = begin;
+		size_t number_of_commands = 0;
+		size_t payload_size = 0;
+		for (; end < commands.size(); end ++)
+		{
+			// custom commands can't cross the process boundary
+			RENDER_COMMAND& command = commands[end];
+			if (command.type == RENDER_COMMAND::TYPE::CUSTOM || command.type == RENDER_COMMAND::TYPE::CUSTOM_CLOSURE)
+			{
+				continue;
+			}
+
+			// get payload size of data not already in the upload heap
+			size_t command_payload_size = 0;
+			visit_command_pointers(command, [&](auto& ptr, size_t size)
+			{
+				if (ptr && !m_ring->is_upload(ptr))
+				{
+					command_payload_size += get_ring_payload_size(ptr, size);
+				}
+			});
+
+			// too big for a packet on its own? move its data into the upload heap, dropping the command if that can't hold it either
+			if (sizeof(RING_PACKET) + sizeof(RENDER_COMMAND) + command_payload_size > max_packet_size)
+			{
+				bool uploaded = true;
+				visit_command_pointers(command, [&](auto& ptr, size_t size)
+				{
+					using POINTER = std::remove_reference_t<decltype(ptr)>;
+					if (!ptr || m_ring->is_upload(ptr) || !uploaded)
+					{
+						return;
+					}
+					size_t data_size = size == SIZE_MAX ? strlen((const char*)ptr) + 1 : size;
+					void* upload = m_ring->alloc_upload(data_size, m_frame_index);
+					if (!upload)
+					{
+						uploaded = false;
+						return;
+					}
+					memcpy(upload, ptr, data_size);
+					ptr = (POINTER)upload;
+				});
+				if (!uploaded)
+				{
+					command.type = RENDER_COMMAND::TYPE::NOT_SET;
+					number_of_dropped_commands ++;
+				}
+				command_payload_size = 0;
+			}
+
+			// packet full?
+			if (number_of_commands && sizeof(RING_PACKET) + (number_of_commands + 1) * sizeof(RENDER_COMMAND) + payload_size + command_payload_size > max_packet_size)
+			{
+				break;
+			}
+
+			// add command
+			number_of_commands ++;
+			payload_size += command_payload_size;
+		}
+
+		// begin packet
+		size_t size = sizeof(RING_PACKET) + number_of_commands * sizeof(RENDER_COMMAND) + payload_size;
+		uint8_t* data = (uint8_t*)m_ring->begin_write(size);
+		size_t copy_end = end;
+
+		// packet too big for the ring?
+		if (!data && m_ring->is_peer_alive())
+		{
+			// drop its commands but keep the frame boundary
+			number_of_dropped_commands += number_of_commands;
+			number_of_commands = 0;
+			copy_end = begin;
+			data = (uint8_t*)m_ring->begin_write(sizeof(RING_PACKET));
+		}
+
+		// host gone?
+		if (!data)
+		{
+			begin = end;
+			continue;
+		}
+
+		// write packet header
+		RING_PACKET* packet = (RING_PACKET*)data;
+		packet->number_of_commands = (uint32_t)number_of_commands;
+		packet->frame_index = m_frame_index;
+		packet->flags = (end_of_frame && end == commands.size() ? RING_PACKET::FLAGS::END_OF_FRAME : 0) | (flush ? RING_PACKET::FLAGS::FLUSH : 0);
+		packet->padding = 0;
+
+		// loop through commands
+		RENDER_COMMAND* packet_command = (RENDER_COMMAND*)(packet + 1);
+		size_t offset = sizeof(RING_PACKET) + number_of_commands * sizeof(RENDER_COMMAND);
+		for (size_t i = begin; i < copy_end; i ++)
+		{
+			// ignore custom command?
+			if (commands[i].type == RENDER_COMMAND::TYPE::CUSTOM || commands[i].type == RENDER_COMMAND::TYPE::CUSTOM_CLOSURE)
+			{
+				continue;
+			}
+
+			// copy command
+			memcpy((void*)packet_command, &commands[i], sizeof(RENDER_COMMAND));
+
+			// native resources can't cross the process boundary
+			clear_native_resources(*packet_command);
+
+			// copy referenced data into packet and turn pointers into offsets
+			visit_command_pointers(*packet_command, [&](auto& ptr, size_t size)
+			{
+				using POINTER = std::remove_reference_t<decltype(ptr)>;
+				if (!ptr)
+				{
+					return;
+				}
+				if (m_ring->is_upload(ptr))
+				{
+					ptr = (POINTER)(uintptr_t)(m_ring->get_upload_offset(ptr) | RING_UPLOAD_POINTER);
+					return;
+				}
+				size_t data_size = size == SIZE_MAX ? strlen((const char*)ptr) + 1 : size;
+				memcpy(data + offset, ptr, data_size);
+				ptr = (POINTER)(uintptr_t)offset;
+				offset += (data_size + 15) & ~(size_t)15;
+			});
+
+			// next command
+			packet_command ++;
+		}
+
+		// end packet
+		m_ring->end_write();
+
+		// next packet
+		begin = end;
+	}
+	while (begin < commands.size());
+
+	// clear commands
+	destroy_closures(commands);
+	commands.resize(0);
+
+	// return number of dropped commands
+	return number_of_dropped_commands;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+bool RENDERER::read_ring_command(const RENDER_RING& ring, RENDER_COMMAND& command, const uint8_t* data, size_t size, size_t payload_offset)
+{
+	// commands that carry code, index host state or would overrun their inline data can't come from another process
+	bool valid = true;
+	switch (command.type)
+	{
+	case RENDER_COMMAND::TYPE::APPLY_BINDING_SET:
+	case RENDER_COMMAND::TYPE::CUSTOM:
+	case RENDER_COMMAND::TYPE::CUSTOM_CLOSURE:
+		valid = false;
+		break;
+	case RENDER_COMMAND::TYPE::APPLY_UNIFORMS:
+		valid = (command.apply_uniforms.stage == SG_SHADERSTAGE_VS || command.apply_uniforms.stage == SG_SHADERSTAGE_FS) && command.apply_uniforms.ub_index >= 0 && command.apply_uniforms.ub_index < SG_MAX_SHADERSTAGE_UBS && command.apply_uniforms.data_size <= sizeof(command.apply_uniforms.buf);
+		break;
+	default:
+		valid = command.type >= RENDER_COMMAND::TYPE::NOT_SET && command.type < RENDER_COMMAND::TYPE::CUSTOM;
+		break;
+	}
+	if (!valid)
+	{
+		command.type = RENDER_COMMAND::TYPE::NOT_SET;
+		return false;
+	}
 
-	// copy args
-	command.update_image.image = image;
-	command.update_image.data = data;
-}
+	// native resources belong to the client process
+	clear_native_resources(command);
 
-// ----------------------------------------------------------------------------------------------------
+	// turn offsets back into pointers, checking everything lies inside the packet payload or the upload heap
+	const uint8_t* upload = (const uint8_t*)ring.get_upload_ptr(0);
+	size_t upload_size = ring.get_upload_capacity();
+	visit_command_pointers(command, [&](auto& ptr, size_t ptr_size)
+	{
+		// get data
+		using POINTER = std::remove_reference_t<decltype(ptr)>;
+		uint64_t offset = (uint64_t)(uintptr_t)ptr;
+		ptr = nullptr;
+		if (!offset || !valid)
+		{
+			return;
+		}
+		bool is_upload = offset & RING_UPLOAD_POINTER;
+		offset &= ~RING_UPLOAD_POINTER;
+		const uint8_t* begin = is_upload ? upload : data + payload_offset;
+		size_t available = is_upload ? upload_size : size - payload_offset;
+		if (is_upload ? offset > available : (offset < payload_offset || offset > size))
+		{
+			valid = false;
+			return;
+		}
+		if (!is_upload)
+		{
+			offset -= payload_offset;
+		}
+		available -= (size_t)offset;
 
-void RENDERER::add_command_begin_default_pass(const sg_pass_action& pass_action)
-{
-	// add command
-	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::BEGIN_DEFAULT_PASS);
+		// string? copy it so the client can't move its terminator once it's been found
+		if (ptr_size == SIZE_MAX)
+		{
+			const void* end = memchr(begin + offset, 0, available);
+			if (!end)
+			{
+				valid = false;
+				return;
+			}
+			ptr = (POINTER)m_ring_strings.emplace_back((const char*)begin + offset, (const char*)end).c_str();
+			return;
+		}
 
-	// copy args
-	command.begin_default_pass.pass_action = pass_action;
+		// data
+		if (ptr_size > available)
+		{
+			valid = false;
+			return;
+		}
+		ptr = (POINTER)(begin + offset);
+	});
+	if (!valid)
+	{
+		command.type = RENDER_COMMAND::TYPE::NOT_SET;
+	}
+
+	// return whether the command can be executed
+	return valid;
 }
 
 // ----------------------------------------------------------------------------------------------------
 
-void RENDERER::add_command_begin_pass(sg_pass pass, const sg_pass_action& pass_action)
+void RENDERER::translate_ring_handles(RENDER_COMMAND& command)
 {
-	// add command
-	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::BEGIN_PASS);
-
-	// copy args
-	command.begin_pass.pass = pass;
-	command.begin_pass.pass_action = pass_action;
+	// translate handles
+	switch (command.type)
+	{
+	case RENDER_COMMAND::TYPE::MAKE_BUFFER:
+		if (!make_ring_handle(RESOURCE_TYPE::BUFFER, command.make_buffer.buffer.id))
+		{
+			command.type = RENDER_COMMAND::TYPE::NOT_SET;
+		}
+		break;
+	case RENDER_COMMAND::TYPE::MAKE_IMAGE:
+		if (!make_ring_handle(RESOURCE_TYPE::IMAGE, command.make_image.image.id))
+		{
+			command.type = RENDER_COMMAND::TYPE::NOT_SET;
+		}
+		break;
+	case RENDER_COMMAND::TYPE::MAKE_SHADER:
+		if (!make_ring_handle(RESOURCE_TYPE::SHADER, command.make_shader.shader.id))
+		{
+			command.type = RENDER_COMMAND::TYPE::NOT_SET;
+		}
+		break;
+	case RENDER_COMMAND::TYPE::MAKE_PIPELINE:
+		if (!make_ring_handle(RESOURCE_TYPE::PIPELINE, command.make_pipeline.pipeline.id))
+		{
+			command.type = RENDER_COMMAND::TYPE::NOT_SET;
+		}
+		command.make_pipeline.desc.shader.id = lookup_ring_handle(RESOURCE_TYPE::SHADER, command.make_pipeline.desc.shader.id);
+		break;
+	case RENDER_COMMAND::TYPE::MAKE_PASS:
+		if (!make_ring_handle(RESOURCE_TYPE::PASS, command.make_pass.pass.id))
+		{
+			command.type = RENDER_COMMAND::TYPE::NOT_SET;
+		}
+		for (auto& attachment : command.make_pass.desc.color_attachments)
+		{
+			attachment.image.id = lookup_ring_handle(RESOURCE_TYPE::IMAGE, attachment.image.id);
+		}
+		command.make_pass.desc.depth_stencil_attachment.image.id = lookup_ring_handle(RESOURCE_TYPE::IMAGE, command.make_pass.desc.depth_stencil_attachment.image.id);
+		break;
+	case RENDER_COMMAND::TYPE::DESTROY_BUFFER:
+		command.destroy_buffer.buffer.id = unbind_ring_handle(RESOURCE_TYPE::BUFFER, command.destroy_buffer.buffer.id);
+		break;
+	case RENDER_COMMAND::TYPE::DESTROY_IMAGE:
+		command.destroy_image.image.id = unbind_ring_handle(RESOURCE_TYPE::IMAGE, command.destroy_image.image.id);
+		break;
+	case RENDER_COMMAND::TYPE::DESTROY_SHADER:
+		command.destroy_shader.shader.id = unbind_ring_handle(RESOURCE_TYPE::SHADER, command.destroy_shader.shader.id);
+		break;
+	case RENDER_COMMAND::TYPE::DESTROY_PIPELINE:
+		command.destroy_pipeline.pipeline.id = unbind_ring_handle(RESOURCE_TYPE::PIPELINE, command.destroy_pipeline.pipeline.id);
+		break;
+	case RENDER_COMMAND::TYPE::DESTROY_PASS:
+		command.destroy_pass.pass.id = unbind_ring_handle(RESOURCE_TYPE::PASS, command.destroy_pass.pass.id);
+		break;
+	case RENDER_COMMAND::TYPE::UPDATE_BUFFER:
+		command.update_buffer.buffer.id = lookup_ring_handle(RESOURCE_TYPE::BUFFER, command.update_buffer.buffer.id);
+		break;
+	case RENDER_COMMAND::TYPE::APPEND_BUFFER:
+		command.append_buffer.buffer.id = lookup_ring_handle(RESOURCE_TYPE::BUFFER, command.append_buffer.buffer.id);
+		break;
+	case RENDER_COMMAND::TYPE::UPDATE_IMAGE:
+		command.update_image.image.id = lookup_ring_handle(RESOURCE_TYPE::IMAGE, command.update_image.image.id);
+		break;
+	case RENDER_COMMAND::TYPE::BEGIN_PASS:
+		command.begin_pass.pass.id = lookup_ring_handle(RESOURCE_TYPE::PASS, command.begin_pass.pass.id);
+		break;
+	case RENDER_COMMAND::TYPE::APPLY_PIPELINE:
+		command.apply_pipeline.pipeline.id = lookup_ring_handle(RESOURCE_TYPE::PIPELINE, command.apply_pipeline.pipeline.id);
+		break;
+	case RENDER_COMMAND::TYPE::APPLY_BINDINGS:
+		for (auto& buffer : command.apply_bindings.bindings.vertex_buffers)
+		{
+			buffer.id = lookup_ring_handle(RESOURCE_TYPE::BUFFER, buffer.id);
+		}
+		command.apply_bindings.bindings.index_buffer.id = lookup_ring_handle(RESOURCE_TYPE::BUFFER, command.apply_bindings.bindings.index_buffer.id);
+		for (auto& image : command.apply_bindings.bindings.vs_images)
+		{
+			image.id = lookup_ring_handle(RESOURCE_TYPE::IMAGE, image.id);
+		}
+		for (auto& image : command.apply_bindings.bindings.fs_images)
+		{
+			image.id = lookup_ring_handle(RESOURCE_TYPE::IMAGE, image.id);
+		}
+		break;
+	default:
+		break;
+	}
 }
 
 // ----------------------------------------------------------------------------------------------------
 
-void RENDERER::add_command_apply_viewport(int x, int y, int width, int height, bool origin_top_left)
+bool RENDERER::make_ring_handle(RESOURCE_TYPE::ENUM type, uint32_t& id)
 {
-	// add command
-	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::APPLY_VIEWPORT);
+	// invalid, out of range or still made? only a misbehaving client sends these
+	const std::vector<uint32_t>& handles = m_ring_handles[type];
+	if (id == SG_INVALID_ID || id >= MAX_RING_HANDLES || (id < handles.size() && handles[id] != SG_INVALID_ID))
+	{
+		return false;
+	}
 
-	// copy args
-	command.apply_viewport.x = x;
-	command.apply_viewport.y = y;
-	command.apply_viewport.width = width;
-	command.apply_viewport.height = height;
-	command.apply_viewport.origin_top_left = origin_top_left;
+	// bind new host handle
+	id = bind_ring_handle(type, id, alloc_host_handle(type));
+	return id != SG_INVALID_ID;
 }
 
 // ----------------------------------------------------------------------------------------------------
 
-void RENDERER::add_command_apply_scissor_rect(int x, int y, int width, int height, bool origin_top_left)
+uint32_t RENDERER::unbind_ring_handle(RESOURCE_TYPE::ENUM type, uint32_t id)
 {
-	// add command
-	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::APPLY_SCISSOR_RECT);
+	// not bound?
+	uint32_t host_id = lookup_ring_handle(type, id);
+	if (host_id == SG_INVALID_ID)
+	{
+		return SG_INVALID_ID;
+	}
 
-	// copy args
-	command.apply_scissor_rect.x = x;
-	command.apply_scissor_rect.y = y;
-	command.apply_scissor_rect.width = width;
-	command.apply_scissor_rect.height = height;
-	command.apply_scissor_rect.origin_top_left = origin_top_left;
+	// unbind now so a recycled client handle can be made again, the host handle is deallocated after the frame executes
+	bind_ring_handle(type, id, SG_INVALID_ID);
+	m_ring_deallocs.emplace_back(type, host_id);
+
+	// return host handle
+	return host_id;
 }
 
 // ----------------------------------------------------------------------------------------------------
 
-void RENDERER::add_command_apply_pipeline(sg_pipeline pipeline)
+uint32_t RENDERER::bind_ring_handle(RESOURCE_TYPE::ENUM type, uint32_t id, uint32_t host_id)
 {
-	// add command
-	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::APPLY_PIPELINE);
+	// grow handles, never past the largest index a client may use
+	std::vector<uint32_t>& handles = m_ring_handles[type];
+	if (id >= handles.size())
+	{
+		handles.resize(std::min<size_t>(std::max<size_t>(id + 1, handles.size() * 2), MAX_RING_HANDLES), SG_INVALID_ID);
+	}
 
-	// copy args
-	command.apply_pipeline.pipeline = pipeline;
+	// bind handle
+	handles[id] = host_id;
+
+	// return host handle
+	return host_id;
 }
 
 // ----------------------------------------------------------------------------------------------------
 
-void RENDERER::add_command_apply_bindings(const sg_bindings& bindings)
+uint32_t RENDERER::alloc_host_handle(RESOURCE_TYPE::ENUM type)
 {
-	// add command
-	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::APPLY_BINDINGS);
-
-	// copy args
-	command.apply_bindings.bindings = bindings;
+	// alloc handle
+	switch (type)
+	{
+	case RESOURCE_TYPE::BUFFER:
+		return sg_alloc_buffer().id;
+	case RESOURCE_TYPE::IMAGE:
+		return sg_alloc_image().id;
+	case RESOURCE_TYPE::SHADER:
+		return sg_alloc_shader().id;
+	case RESOURCE_TYPE::PIPELINE:
+		return sg_alloc_pipeline().id;
+	case RESOURCE_TYPE::PASS:
+		return sg_alloc_pass().id;
+	default:
+		return SG_INVALID_ID;
+	}
 }
 
 // ----------------------------------------------------------------------------------------------------
 
-void RENDERER::add_command_apply_uniforms(sg_shader_stage stage, int ub_index, const sg_range& data)
+void RENDERER::dealloc_ring_handles()
 {
-	// data size too big?
-	if ((size_t)data.size > sizeof(RENDER_COMMAND::apply_uniforms.buf))
+	// nothing destroyed?
+	if (m_ring_deallocs.empty())
 	{
 		return;
 	}
 
-	// add command
-	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::APPLY_UNIFORMS);
-
-	// copy args
-	command.apply_uniforms.stage = stage;
-	command.apply_uniforms.ub_index = ub_index;
-	memcpy(command.apply_uniforms.buf, data.ptr, data.size);
-	command.apply_uniforms.data_size = data.size;
+	// loop through destroyed handles
+	for (const auto& dealloc : m_ring_deallocs)
+	{
+		// dealloc host handle
+		uint32_t id = dealloc.second;
+		switch (dealloc.first)
+		{
+		case RESOURCE_TYPE::BUFFER:
+			sg_dealloc_buffer({ id });
+			break;
+		case RESOURCE_TYPE::IMAGE:
+			sg_dealloc_image({ id });
+			break;
+		case RESOURCE_TYPE::SHADER:
+			sg_dealloc_shader({ id });
+			break;
+		case RESOURCE_TYPE::PIPELINE:
+			sg_dealloc_pipeline({ id });
+			break;
+		case RESOURCE_TYPE::PASS:
+			sg_dealloc_pass({ id });
+			break;
+		default:
+			break;
+		}
+	}
+	m_ring_deallocs.resize(0);
 }
 
 // ----------------------------------------------------------------------------------------------------
 
-void RENDERER::add_command_draw(int base_element, int number_of_elements, int number_of_instances)
+uint32_t RENDERER::alloc_handle(RESOURCE_TYPE::ENUM type)
 {
-	// add command
-	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::DRAW);
+	// remote? the host allocates its own handle when it makes the resource
+	if (m_ring)
+	{
+		// recycle a handle once the host has executed its destroy
+		std::deque<std::pair<int32_t, uint32_t>>& free_handles = m_ring_free_handles[type];
+		if (!free_handles.empty() && m_ring->get_executed_frame_index() >= free_handles.front().first)
+		{
+			uint32_t id = free_handles.front().second;
+			free_handles.pop_front();
+			return id;
+		}
 
-	// copy args
-	command.draw.base_element = base_element;
-	command.draw.number_of_elements = number_of_elements;
-	command.draw.number_of_instances = number_of_instances;
-}
+		// out of handles?
+		if (m_ring_handle_counters[type] == MAX_RING_HANDLES - 1)
+		{
+			return SG_INVALID_ID;
+		}
+		return ++m_ring_handle_counters[type];
+	}
 
-// ----------------------------------------------------------------------------------------------------
+	// sokol graphics not setup yet? reserve the handle its fresh pool hands out next, the render thread allocates the reserved handles in order when it sets up
+	if (!m_setup_complete.load(std::memory_order_acquire))
+	{
+		// lock out the render thread setting up, and check again
+		std::scoped_lock<std::mutex> lock(m_handle_mutex);
+		if (!m_setup_complete.load(std::memory_order_relaxed))
+		{
+			// pool full?
+			if (m_number_of_reserved_handles[type] == get_pool_size(type))
+			{
+				return SG_INVALID_ID;
+			}
+			return (1 << SLOT_SHIFT) | ++m_number_of_reserved_handles[type];
+		}
+	}
 
-void RENDERER::add_command_end_pass()
-{
-	// add command
-	/*RENDER_COMMAND& command = */m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::END_PASS);
+	// alloc handle
+	return alloc_host_handle(type);
 }
 
 // ----------------------------------------------------------------------------------------------------
 
-void RENDERER::add_command_commit()
+uint32_t RENDERER::get_pool_size(RESOURCE_TYPE::ENUM type) const
 {
-	// add command
-	/*RENDER_COMMAND& command = */m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::COMMIT);
+	// pool size, or the sokol default
+	switch (type)
+	{
+	case RESOURCE_TYPE::BUFFER:
+		return m_desc.buffer_pool_size ? m_desc.buffer_pool_size : 128;
+	case RESOURCE_TYPE::IMAGE:
+		return m_desc.image_pool_size ? m_desc.image_pool_size : 128;
+	case RESOURCE_TYPE::SHADER:
+		return m_desc.shader_pool_size ? m_desc.shader_pool_size : 32;
+	case RESOURCE_TYPE::PIPELINE:
+		return m_desc.pipeline_pool_size ? m_desc.pipeline_pool_size : 64;
+	case RESOURCE_TYPE::PASS:
+		return m_desc.pass_pool_size ? m_desc.pass_pool_size : 16;
+	default:
+		return 0;
+	}
 }
 
 // ----------------------------------------------------------------------------------------------------
 
-void RENDERER::add_command_custom(void (*custom_cb)(void* custom_data), void* custom_data)
+void RENDERER::free_ring_handle(RESOURCE_TYPE::ENUM type, uint32_t id)
 {
-	// add command
-	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::CUSTOM);
+	// not one of ours?
+	if (id == SG_INVALID_ID || id > m_ring_handle_counters[type])
+	{
+		return;
+	}
 
-	// copy args
-	command.custom.custom_cb = custom_cb;
-	command.custom.custom_data = custom_data;
+	// free once the host has executed this frame
+	m_ring_free_handles[type].emplace_back(m_frame_index, id);
 }
 
 // ----------------------------------------------------------------------------------------------------
 
-void RENDERER::schedule_cleanup(void (*cleanup_cb)(void* cleanup_data), void* cleanup_data, int32_t number_of_frames_to_defer)
+void RENDERER::process_cleanups(int32_t frame_index)
 {
-	// add cleanup
-	RENDER_CLEANUP& cleanup = m_cleanups.emplace_back(cleanup_cb, cleanup_data);
+	// hand off to an executor?
+	bool async = m_cleanup_thread.joinable() || m_cleanup_dispatch_cb;
+	CLEANUP_BATCH* batch = nullptr;
+
+	// loop through cleanups
+	for (auto& cleanup : m_cleanups)
+	{
+		// call cleanup cb?
+		if ((cleanup.frame_index <= frame_index || frame_index < 0) && cleanup.cleanup_cb)
+		{
+			// add to batch?
+			if (async && !cleanup.synchronous)
+			{
+				// get batch
+				if (!batch)
+				{
+					std::lock_guard<std::mutex> lock(m_cleanup_mutex);
+					if (m_free_cleanup_batches.empty())
+					{
+						batch = new CLEANUP_BATCH;
+						batch->renderer = this;
+					}
+					else
+					{
+						batch = m_free_cleanup_batches.back();
+						m_free_cleanup_batches.pop_back();
+					}
+				}
+
+				// add cleanup
+				batch->cleanups.push_back(cleanup);
+			}
+			else
+			{
+				// call cleanup cb
+				cleanup.cleanup_cb(cleanup.cleanup_data);
+			}
+			
+			// reset cleanup cb
+			cleanup.cleanup_cb = nullptr;
+		}
+	}
 	
-	// set frame index
-	cleanup.frame_index = m_frame_index + 1 + number_of_frames_to_defer;
+	// erase invalid cleanups
+	m_cleanups.erase(std::remove_if(m_cleanups.begin(), m_cleanups.end(), [](const auto& cleanup) { return !cleanup.cleanup_cb; }), m_cleanups.end());
+
+	// dispatch batch
+	if (batch)
+	{
+		dispatch_cleanup_batch(batch);
+	}
 }
 
 // ----------------------------------------------------------------------------------------------------
 
-void RENDERER::commit_commands()
+void RENDERER::dispatch_cleanup_batch(CLEANUP_BATCH* batch)
 {
-	// acquire render semaphore
-	m_render_semaphore.acquire();
-	
-	// clear commands
-	m_commands[m_commit_commands_index].resize(0);
-	
-	// process cleanups
-	process_cleanups(m_frame_index);
-	
-	// swap commands indexes
-	std::swap(m_pending_commands_index, m_commit_commands_index);
+	// add pending batch
+	{
+		std::lock_guard<std::mutex> lock(m_cleanup_mutex);
+		m_number_of_pending_cleanup_batches ++;
 
-	// increase frame index
-	m_frame_index ++;
+		// queue for cleanup thread?
+		if (!m_cleanup_dispatch_cb)
+		{
+			m_cleanup_batches.push_back(batch);
+		}
+	}
 
-	// release update semaphore
-	m_update_semaphore.release();
+	// user job system?
+	if (m_cleanup_dispatch_cb)
+	{
+		m_cleanup_dispatch_cb(run_cleanup_batch, batch, m_cleanup_dispatch_user_data);
+		return;
+	}
+
+	// wake cleanup thread
+	m_cleanup_cv.notify_one();
 }
 
 // ----------------------------------------------------------------------------------------------------
 
-void RENDERER::flush_commands()
+void RENDERER::run_cleanup_batch(void* run_data)
 {
-	// acquire render semaphore
-	m_render_semaphore.acquire();
-	
-	// clear commands
-	m_commands[m_commit_commands_index].resize(0);
-	
-	// swap commands indexes
-	std::swap(m_pending_commands_index, m_commit_commands_index);
+	// get batch
+	CLEANUP_BATCH* batch = (CLEANUP_BATCH*)run_data;
 
-	// set flushing
-	m_flushing = true;
+	// call cleanup cbs in the order they were scheduled
+	for (const auto& cleanup : batch->cleanups)
+	{
+		cleanup.cleanup_cb(cleanup.cleanup_data);
+	}
 
-	// release update semaphore
-	m_update_semaphore.release();
+	// finish batch
+	batch->renderer->finish_cleanup_batch(batch);
 }
 
 // ----------------------------------------------------------------------------------------------------
 
-const std::string RENDERER::get_name() const
+void RENDERER::finish_cleanup_batch(CLEANUP_BATCH* batch)
 {
-	// return name
-	switch (sg_query_backend())
-	{
-	case SG_BACKEND_GLCORE33:
-		return "OpenGL 3.3";
-	case SG_BACKEND_GLES2:
-		return "OpenGL ES 2.0";
-	case SG_BACKEND_GLES3:
-		return "OpenGL ES 3.0";
-	case SG_BACKEND_D3D11:
-		return "Direct3D 11";
-	case SG_BACKEND_METAL_IOS:
-	case SG_BACKEND_METAL_MACOS:
-	case SG_BACKEND_METAL_SIMULATOR:
-		return "Metal";
-	case SG_BACKEND_WGPU:
-		return "WebGPU";
-	default:
-		return "Unknown";
-	}
+	// recycle batch
+	batch->cleanups.resize(0);
+	std::lock_guard<std::mutex> lock(m_cleanup_mutex);
+	m_free_cleanup_batches.push_back(batch);
+	m_number_of_pending_cleanup_batches --;
+
+	// wake waiters while still holding the lock, a waiter in the destructor may free the renderer as soon as it can see the count
+	m_cleanup_done_cv.notify_all();
 }
 
 // ----------------------------------------------------------------------------------------------------
 
-void RENDERER::process_cleanups(int32_t frame_index)
+void RENDERER::cleanup_thread_loop()
 {
-	// loop through cleanups
-	for (auto& cleanup : m_cleanups)
+	// loop until stopped
+	std::unique_lock<std::mutex> lock(m_cleanup_mutex);
+	for (;;)
 	{
-		// call cleanup cb?
-		if ((cleanup.frame_index <= frame_index || frame_index < 0) && cleanup.cleanup_cb)
+		// wait for batch
+		m_cleanup_cv.wait(lock, [this]() { return !m_cleanup_batches.empty() || m_stop_cleanup_thread; });
+
+		// stopped and drained?
+		if (m_cleanup_batches.empty())
 		{
-			// call cleanup cb
-			cleanup.cleanup_cb(cleanup.cleanup_data);
-			
-			// reset cleanup cb
-			cleanup.cleanup_cb = nullptr;
+			return;
 		}
+
+		// pop batch
+		CLEANUP_BATCH* batch = m_cleanup_batches.front();
+		m_cleanup_batches.pop_front();
+
+		// run batch without holding the lock
+		lock.unlock();
+		run_cleanup_batch(batch);
+		lock.lock();
 	}
-	
-	// erase invalid cleanups
-	m_cleanups.erase(std::remove_if(m_cleanups.begin(), m_cleanups.end(), [](const auto& cleanup) { return !cleanup.cleanup_cb; }), m_cleanups.end());
 }
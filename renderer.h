@@ -3,12 +3,31 @@
 
 // ----------------------------------------------------------------------------------------------------
 
+#include <deque>
+#include <string>
 #include <vector>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
 #include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <new>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <utility>
 
 #include "sokol_gfx.h"
 
 #include "semaphore.h"
+#include "trace.h"
+#include "worker_pool.h"
+
+// ----------------------------------------------------------------------------------------------------
+
+class RENDER_RING;
 
 // ----------------------------------------------------------------------------------------------------
 
@@ -44,17 +63,30 @@ struct RENDER_COMMAND
 			APPLY_SCISSOR_RECT,
 			APPLY_PIPELINE,
 			APPLY_BINDINGS,
+			APPLY_BINDING_SET,
 			APPLY_UNIFORMS,
 			DRAW,
 			END_PASS,
 			COMMIT,
+			RESET,
 			
-			CUSTOM
+			CUSTOM,
+			CUSTOM_CLOSURE
 		};
 	};
+
+	// callables bigger than this are stored on the heap
+	static constexpr size_t MAX_INLINE_CLOSURE_SIZE = 256;
 	
 	RENDER_COMMAND() {}
 	RENDER_COMMAND(TYPE::ENUM _type) : type(_type) {}
+	RENDER_COMMAND(RENDER_COMMAND&& other) noexcept { relocate(other); }
+	RENDER_COMMAND& operator=(RENDER_COMMAND&& other) noexcept { if (this != &other) { if (type == TYPE::CUSTOM_CLOSURE) { destroy_closure(); } relocate(other); } return *this; }
+	RENDER_COMMAND(const RENDER_COMMAND&) = delete;
+	RENDER_COMMAND& operator=(const RENDER_COMMAND&) = delete;
+
+	void* get_closure() { return custom_closure.heap ? custom_closure.heap : custom_closure.buf; }
+	void destroy_closure() { custom_closure.destroy_cb(get_closure()); type = TYPE::NOT_SET; }
 
 	TYPE::ENUM type = TYPE::NOT_SET;
 
@@ -144,15 +176,28 @@ struct RENDER_COMMAND
 			void* custom_data;
 		} custom;
 
+		struct
+		{
+			void (*invoke_cb)(void* closure);
+			void (*destroy_cb)(void* closure);
+			void (*relocate_cb)(void* dst, void* src);
+			void* heap;
+			alignas(std::max_align_t) char buf[MAX_INLINE_CLOSURE_SIZE];
+		} custom_closure;
+
 		struct
 		{
 			sg_pass_action pass_action;
+			float resolution_scale;
 		} begin_default_pass;
 
 		struct
 		{
 			sg_pass pass;
 			sg_pass_action pass_action;
+			float resolution_scale;
+			int width;
+			int height;
 		} begin_pass;
 
 		struct
@@ -182,6 +227,14 @@ struct RENDER_COMMAND
 		{
 			sg_bindings bindings;
 		} apply_bindings;
+
+		struct
+		{
+			uint32_t binding_set;
+			bool offsets;
+			int vertex_buffer_offsets[SG_MAX_SHADERSTAGE_BUFFERS];
+			int index_buffer_offset;
+		} apply_binding_set;
 		
 		struct
 		{
@@ -198,6 +251,22 @@ struct RENDER_COMMAND
 			int number_of_instances;
 		} draw;
 	};
+
+private:
+	void relocate(RENDER_COMMAND& other)
+	{
+		// copy command
+		memcpy((void*)this, (const void*)&other, sizeof(RENDER_COMMAND));
+
+		// move inline closures that can't simply be copied
+		if (type == TYPE::CUSTOM_CLOSURE && !custom_closure.heap && custom_closure.relocate_cb)
+		{
+			custom_closure.relocate_cb(custom_closure.buf, other.custom_closure.buf);
+		}
+
+		// other no longer owns anything
+		other.type = TYPE::NOT_SET;
+	}
 };
 
 // ----------------------------------------------------------------------------------------------------
@@ -214,6 +283,7 @@ struct RENDER_CLEANUP
 	void (*cleanup_cb)(void* cleanup_data) = nullptr;
 	void* cleanup_data = nullptr;
 	int32_t frame_index = 0;
+	bool synchronous = false;
 };
 
 // ----------------------------------------------------------------------------------------------------
@@ -222,10 +292,155 @@ typedef std::vector<RENDER_CLEANUP> RENDER_CLEANUP_ARRAY;
 
 // ----------------------------------------------------------------------------------------------------
 
+struct RENDER_THREAD_DESC
+{
+	// types
+	struct WAIT_POLICY
+	{
+		enum ENUM
+		{
+			BLOCK = 0,
+			SPIN,
+			HYBRID
+		};
+	};
+
+	struct PRIORITY
+	{
+		enum ENUM
+		{
+			NORMAL = 0,
+			LOW,
+			HIGH,
+			HIGHEST
+		};
+	};
+
+	// how the render thread waits for the next commit
+	WAIT_POLICY::ENUM wait_policy = WAIT_POLICY::BLOCK;
+	uint32_t spin_count = 4096;
+
+	// scheduling
+	PRIORITY::ENUM priority = PRIORITY::NORMAL;
+	std::vector<int32_t> cpus;
+
+	// callbacks made from the render thread, e.g. to make the context current and present
+	void (*thread_start_cb)(void* user_data) = nullptr;
+	void (*frame_cb)(void* user_data) = nullptr;
+	void (*thread_end_cb)(void* user_data) = nullptr;
+	void* user_data = nullptr;
+};
+
+// ----------------------------------------------------------------------------------------------------
+
+struct RENDER_BOUNDS
+{
+	// sphere (extents left at zero) or axis aligned box (radius left at zero)
+	float center[3] = {};
+	float extents[3] = {};
+	float radius = 0.0f;
+};
+
+// ----------------------------------------------------------------------------------------------------
+
+struct RENDER_DRAW
+{
+	// state, only applied when it differs from the previous draw in the batch, bindings are used when binding_set is zero
+	sg_pipeline pipeline = {};
+	uint32_t binding_set = 0;
+	const sg_bindings* bindings = nullptr;
+
+	// uniform block, not applied when uniforms.size is zero
+	sg_shader_stage uniform_stage = SG_SHADERSTAGE_VS;
+	int uniform_block = 0;
+	sg_range uniforms = {};
+
+	// element range
+	int base_element = 0;
+	int number_of_elements = 0;
+	int number_of_instances = 1;
+};
+
+// ----------------------------------------------------------------------------------------------------
+
+struct RENDER_TEXTURE_DESC
+{
+	// source pixels, must stay valid until cleanup_cb is called
+	const void* data = nullptr;
+	int width = 0;
+	int height = 0;
+	sg_pixel_format source_pixel_format = SG_PIXELFORMAT_RGBA8;
+
+	// format the pixels are converted to, R8, RGBA8, BGRA8, RGBA16F or RGBA32F
+	sg_pixel_format pixel_format = SG_PIXELFORMAT_RGBA8;
+	bool generate_mipmaps = true;
+
+	// made images only, width, height, pixel format, number of mipmaps and data are filled in from the above
+	sg_image_desc image_desc = {};
+
+	// called from the update thread once the source pixels are no longer needed
+	void (*cleanup_cb)(void* cleanup_data) = nullptr;
+	void* cleanup_data = nullptr;
+};
+
+// ----------------------------------------------------------------------------------------------------
+
+struct RENDER_RESOLUTION_DESC
+{
+	// render thread time in milliseconds to execute a frame's commands
+	double frame_budget = 12.0;
+
+	// scale range and the step the scale is rounded to
+	float min_scale = 0.5f;
+	float max_scale = 1.0f;
+	float step = 0.05f;
+
+	// the scale only changes once the smoothed time has been more than hysteresis (as a fraction of the budget) over or under the budget for number_of_frames frames in a row
+	float hysteresis = 0.1f;
+	int32_t number_of_frames = 8;
+};
+
+// ----------------------------------------------------------------------------------------------------
+
+struct RENDER_STATS
+{
+	// culling, time in milliseconds
+	uint32_t number_of_cull_tests = 0;
+	uint32_t number_of_culled_draws = 0;
+	double cull_time = 0.0;
+
+	// command optimizer
+	uint32_t number_of_dead_state_commands = 0;
+	uint32_t number_of_empty_draws = 0;
+	uint32_t number_of_removed_debug_groups = 0;
+	uint32_t number_of_folded_passes = 0;
+
+	// out of process, commands whose data fit in neither a ring packet nor the upload heap, so the host never saw them
+	uint32_t number_of_dropped_commands = 0;
+
+	// binding sets alive at commit, and create_binding_set() calls that returned 0 because every set was in use
+	uint32_t number_of_binding_sets = 0;
+	uint32_t number_of_failed_binding_sets = 0;
+
+	// draw batches, records skipped because their binding set was destroyed or their uniforms didn't fit a command, time in milliseconds spent recording them
+	uint32_t number_of_draw_batches = 0;
+	uint32_t number_of_batched_draws = 0;
+	uint32_t number_of_skipped_draws = 0;
+	double batch_time = 0.0;
+
+	// dynamic resolution, execute time in milliseconds of the last frame the render thread executed
+	double execute_time = 0.0;
+	float resolution_scale = 1.0f;
+};
+
+// ----------------------------------------------------------------------------------------------------
+
 class RENDERER
 {
 public:
-	RENDERER(const sg_desc& desc);
+	// setup_on_render_thread defers sg_setup() to the render thread's first execute and sg_shutdown() to the end of its final flush, resources can be recorded straight away
+	RENDERER(const sg_desc& desc, bool setup_on_render_thread = false);
+	RENDERER(RENDER_RING* ring);
 	~RENDERER();
 
 	// render thread functions
@@ -234,6 +449,13 @@ public:
 
 	void set_default_pass_size(int width, int height) { m_default_pass_width = width; m_default_pass_height = height; }
 
+	// render thread owned by the renderer, replaces calling execute_commands() and wait_for_flush(), stopping it flushes first if flush_commands() wasn't called
+	void start_render_thread(const RENDER_THREAD_DESC& desc);
+	void stop_render_thread();
+
+	// host process function, executes one frame sent through the ring by a remote renderer, returns false once flushed or disconnected
+	bool execute_ring_commands(RENDER_RING& ring);
+
 	// update thread functions
 	void add_command_push_debug_group(const char* name);
 	void add_command_pop_debug_group();
@@ -253,6 +475,10 @@ public:
 	void add_command_update_buffer(sg_buffer buffer, const sg_range& data);
 	void add_command_append_buffer(sg_buffer buffer, const sg_range& data);
 	void add_command_update_image(sg_image image, const sg_image_data& data);
+
+	// images are converted and mipmapped on the worker threads, the make / update command is added by the first commit after they're ready
+	sg_image add_command_make_image_async(const RENDER_TEXTURE_DESC& desc);
+	void add_command_update_image_async(sg_image image, const RENDER_TEXTURE_DESC& desc);
 	
 	void add_command_begin_default_pass(const sg_pass_action& pass_action);
 	void add_command_begin_pass(sg_pass pass, const sg_pass_action& pass_action);
@@ -260,27 +486,242 @@ public:
 	void add_command_apply_scissor_rect(int x, int y, int width, int height, bool origin_top_left);
 	void add_command_apply_pipeline(sg_pipeline pipeline);
 	void add_command_apply_bindings(const sg_bindings& bindings);
+	void add_command_apply_binding_set(uint32_t binding_set);
+	void add_command_apply_binding_set(uint32_t binding_set, const int* vertex_buffer_offsets, int number_of_vertex_buffer_offsets, int index_buffer_offset);
 	void add_command_apply_uniforms(sg_shader_stage stage, int ub_index, const sg_range& data);
 	void add_command_draw(int base_element, int number_of_elements, int number_of_instances);
+	void add_command_draw_culled(const RENDER_BOUNDS& bounds, int base_element, int number_of_elements, int number_of_instances);
+	void add_commands_draw_batch(const RENDER_DRAW* draws, size_t number_of_draws);
 	void add_command_end_pass();
 	void add_command_commit();
 
+	// commands are optimized when submitted, removing dead state, empty draws, empty debug groups and passes that don't clear
+	void set_optimize_commands(bool enabled) { m_optimize_commands = enabled; }
+	void set_strip_debug_groups(bool enabled) { m_strip_debug_groups = enabled; }
+
+	// dynamic resolution, passes begun while it is enabled render to the top left scale * size of the target, viewports and scissor rects within them are scaled to match
+	// the scale only changes in commit_commands(), so every pass of a frame uses the one returned while it's recorded, registered passes are given their full size
+	void enable_dynamic_resolution(const RENDER_RESOLUTION_DESC& desc);
+	void disable_dynamic_resolution();
+	float get_resolution_scale() const { return m_resolution_scale; }
+	void register_scalable_pass(sg_pass pass, int width, int height) { m_scalable_passes[pass.id] = { width, height }; }
+	void unregister_scalable_pass(sg_pass pass) { m_scalable_passes.erase(pass.id); }
+
+	// planes are (a, b, c, d) with a*x + b*y + c*z + d >= 0 inside, culled draws are tested against the last frustum set this frame
+	void set_cull_frustum(const float planes[6][4]);
+
+	// worker threads, used to cull in parallel and prepare images
+	void start_worker_threads(int32_t number_of_threads) { m_worker_pool.start(number_of_threads); }
+	void stop_worker_threads() { m_worker_pool.stop(); }
+
+	// binding sets are interned and reference counted, creating an identical set returns the same id, 0 if out of sets
+	// each create_binding_set() is matched by a destroy_binding_set(), and the id is reused once the frame that destroyed it has executed
+	uint32_t create_binding_set(const sg_bindings& bindings);
+	void destroy_binding_set(uint32_t binding_set);
+
 	void add_command_custom(void (*custom_cb)(void* custom_data), void* custom_data);
+	template <typename F> void add_command_custom(F&& fn);
 	
 	void schedule_cleanup(void (*cleanup_cb)(void* cleanup_data), void* cleanup_data, int32_t number_of_frames_to_defer = 0);
+	void* alloc_frame_data(size_t size);
+
+	// cleanup executor functions, due cleanups are handed off in order instead of being called inside commit_commands()
+	void start_cleanup_thread();
+	void stop_cleanup_thread();
+	void set_cleanup_dispatch_cb(void (*dispatch_cb)(void (*run_cb)(void* run_data), void* run_data, void* user_data), void* user_data);
+	void wait_for_cleanups();
 
+	void submit_partial();
 	void commit_commands();
 	void flush_commands();
+
+	// fast teardown skips the per object work sg_shutdown() makes redundant, flushing no longer makes or destroys resources and handle deallocations are dropped
+	void set_fast_teardown(bool enabled) { m_fast_teardown.store(enabled, std::memory_order_relaxed); }
+
+	// destroys every resource by restarting sokol graphics with the same desc, blocks until the render thread has done so, all existing handles become invalid
+	void reset();
+
+	// time in milliseconds the last flush_commands() (until the render thread has executed the flush) or reset() took
+	double get_teardown_time() const { return m_teardown_time.load(std::memory_order_relaxed); }
 	
 	void lock_execute_mutex() { m_execute_mutex.lock(); }
 	void unlock_execute_mutex() { m_execute_mutex.unlock(); }
 
 	const std::string get_name() const;
 
+	// fence functions, a fence completes once the frame it was taken in has been committed and executed
+	// wait_for_fence() is called from the update thread and returns false rather than blocking forever for a frame that was never committed or when called from the render thread
+	int32_t get_current_frame_fence() const { return m_frame_index; }
+	bool is_fence_complete(int32_t fence) const;
+	bool wait_for_fence(int32_t fence);
+	int32_t get_executed_frame_index() const;
+
+	// false until the render thread has setup sokol graphics, sokol functions (get_name(), get_pixel_format(), ...) can't be called before then
+	bool is_setup_complete() const { return m_setup_complete.load(std::memory_order_acquire); }
+
+	// stats for the last committed frame
+	const RENDER_STATS& get_stats() const { return m_stats; }
+
 	sg_pixel_format get_pixel_format() const { return sg_query_desc().context.color_format; }
+
+	// pipeline manifest functions, shaders and pipelines made while recording can be saved and then prewarmed on the next launch
+	void record_pipeline_manifest(bool enabled) { m_record_manifest = enabled; }
+	bool save_pipeline_manifest(const char* filename) const;
+	bool load_pipeline_manifest(const char* filename);
+
+	// render thread function, builds up to number_of_objects prewarmed shaders/pipelines (e.g. on loading screens), returns false once there's nothing left to build
+	bool execute_prewarm(int32_t number_of_objects = 1);
+
+	// trace functions
+	void enable_trace(uint32_t number_of_events_per_thread = 65536);
+	void disable_trace();
+	bool write_trace(const char* filename) const;
 	
 private:
+	// types
+	struct RESOURCE_TYPE
+	{
+		enum ENUM
+		{
+			BUFFER = 0,
+			IMAGE,
+			SHADER,
+			PIPELINE,
+			PASS,
+
+			COUNT
+		};
+	};
+
+	struct PREWARM_STATE
+	{
+		enum ENUM
+		{
+			RESERVED = 0,
+			BUILDING,
+			BUILT,
+			CLAIMED
+		};
+	};
+
+	struct MANIFEST_ENTRY
+	{
+		RESOURCE_TYPE::ENUM type = RESOURCE_TYPE::SHADER;
+		uint64_t hash = 0;
+		uint64_t shader_hash = 0;
+		std::vector<uint8_t> data;
+	};
+
+	struct PREWARM_ENTRY
+	{
+		RESOURCE_TYPE::ENUM type = RESOURCE_TYPE::SHADER;
+		std::vector<uint8_t> data;
+		uint32_t id = SG_INVALID_ID;
+		std::atomic<int32_t> state = PREWARM_STATE::RESERVED;
+	};
+
+	struct CULL_FRUSTUM
+	{
+		float planes[6][4];
+		float abs_normals[6][3];
+		std::vector<float> center_x;
+		std::vector<float> center_y;
+		std::vector<float> center_z;
+		std::vector<float> extents_x;
+		std::vector<float> extents_y;
+		std::vector<float> extents_z;
+		std::vector<float> radius;
+		std::vector<uint32_t> commands;
+		std::vector<uint8_t> visible;
+	};
+
+	struct CLEANUP_BATCH
+	{
+		RENDERER* renderer = nullptr;
+		RENDER_CLEANUP_ARRAY cleanups;
+	};
+
+	struct TEXTURE_JOB
+	{
+		RENDERER* renderer = nullptr;
+		RENDER_TEXTURE_DESC desc;
+		sg_image image = {};
+		bool make = false;
+		int number_of_mipmaps = 1;
+		void* data = nullptr;
+		sg_image_data image_data = {};
+		uint32_t reset_count = 0;
+		bool finished = false;
+	};
+
+	struct TEXTURE_IMAGE_JOBS
+	{
+		std::deque<TEXTURE_JOB*> jobs;
+		bool destroy = false;
+	};
+
+	static constexpr uint32_t BINDING_SET_PAGE_SIZE = 256;
+	static constexpr uint32_t MAX_BINDING_SET_PAGES = 256;
+
+	bool is_binding_set(uint32_t binding_set) const { return binding_set && binding_set <= m_number_of_binding_sets && m_binding_set_refs[binding_set - 1]; }
+	const sg_bindings& get_binding_set(uint32_t binding_set) const { return m_binding_set_pages[(binding_set - 1) / BINDING_SET_PAGE_SIZE][(binding_set - 1) % BINDING_SET_PAGE_SIZE]; }
+
+	// handles reserved before sokol graphics is setup are the ones a fresh pool hands out, slot index 1, 2, 3... with a generation counter of 1
+	static constexpr uint32_t SLOT_SHIFT = 16;
+	static constexpr uint32_t MAX_RING_HANDLES = 0x10000;
+
+	sg_buffer alloc_buffer() { return { alloc_handle(RESOURCE_TYPE::BUFFER) }; }
+	sg_image alloc_image() { return { alloc_handle(RESOURCE_TYPE::IMAGE) }; }
+	sg_shader alloc_shader() { return { alloc_handle(RESOURCE_TYPE::SHADER) }; }
+	sg_pipeline alloc_pipeline() { return { alloc_handle(RESOURCE_TYPE::PIPELINE) }; }
+	sg_pass alloc_pass() { return { alloc_handle(RESOURCE_TYPE::PASS) }; }
+	uint32_t alloc_handle(RESOURCE_TYPE::ENUM type);
+	uint32_t get_pool_size(RESOURCE_TYPE::ENUM type) const;
+	void complete_setup();
+	void complete_shutdown();
+
+	size_t write_ring_commands(bool flush, bool end_of_frame);
+	bool read_ring_command(const RENDER_RING& ring, RENDER_COMMAND& command, const uint8_t* data, size_t size, size_t payload_offset);
+	void translate_ring_handles(RENDER_COMMAND& command);
+	uint32_t lookup_ring_handle(RESOURCE_TYPE::ENUM type, uint32_t id) const { return id < m_ring_handles[type].size() ? m_ring_handles[type][id] : (uint32_t)SG_INVALID_ID; }
+	bool make_ring_handle(RESOURCE_TYPE::ENUM type, uint32_t& id);
+	uint32_t unbind_ring_handle(RESOURCE_TYPE::ENUM type, uint32_t id);
+	uint32_t bind_ring_handle(RESOURCE_TYPE::ENUM type, uint32_t id, uint32_t host_id);
+	void free_ring_handle(RESOURCE_TYPE::ENUM type, uint32_t id);
+	uint32_t alloc_host_handle(RESOURCE_TYPE::ENUM type);
+	void dealloc_ring_handles();
+
+	uint64_t record_manifest_command(RENDER_COMMAND& command, uint64_t shader_hash);
+	uint32_t claim_prewarm_entry(uint64_t hash, uint32_t shader_id, bool& built);
+	bool build_prewarm_entry();
+
+	void cull_commands(bool end_of_frame);
+	void optimize_commands(RENDER_COMMAND_ARRAY& commands);
+	static void cull_range(CULL_FRUSTUM& frustum, size_t begin, size_t end);
+
+	void publish_executed_frame_index(int32_t frame_index);
+	void publish_teardown_time();
+	void update_resolution_scale();
+	void set_resolution_scale(float scale, double step_time);
+	void apply_scaled_rect(RENDER_COMMAND::TYPE::ENUM type, int x, int y, int width, int height, bool origin_top_left);
+	void execute_frame(bool resource_only);
+	void execute_command_array(RENDER_COMMAND_ARRAY& commands, bool resource_only);
+	static void destroy_closures(RENDER_COMMAND_ARRAY& commands);
+	void render_thread_loop();
 	void process_cleanups(int32_t frame_index);
+	void schedule_synchronous_cleanup(void (*cleanup_cb)(void* cleanup_data), void* cleanup_data);
+	void dispatch_cleanup_batch(CLEANUP_BATCH* batch);
+	void finish_cleanup_batch(CLEANUP_BATCH* batch);
+	void cleanup_thread_loop();
+	static void run_cleanup_batch(void* run_data);
+	void submit_texture_job(sg_image image, bool make, const RENDER_TEXTURE_DESC& desc);
+	static void run_texture_job(void* job_data);
+	void add_texture_job_commands();
+	void add_texture_job_command(TEXTURE_JOB* job, bool destroyed);
+	void destroy_texture_jobs();
+
+	void trace_begin(TRACE::THREAD::ENUM thread, const char* name) { TRACE* trace = m_trace.load(std::memory_order_acquire); if (trace) trace->begin(thread, name); }
+	void trace_end(TRACE::THREAD::ENUM thread) { TRACE* trace = m_trace.load(std::memory_order_acquire); if (trace) trace->end(thread); }
 
 	static void dealloc_buffer_cb(void* cleanup_data) { sg_dealloc_buffer({(uint32_t)(uintptr_t)cleanup_data}); }
 	static void dealloc_image_cb(void* cleanup_data) { sg_dealloc_image({(uint32_t)(uintptr_t)cleanup_data}); }
@@ -288,6 +729,7 @@ private:
 	static void dealloc_pipeline_cb(void* cleanup_data) { sg_dealloc_pipeline({(uint32_t)(uintptr_t)cleanup_data}); }
 	static void dealloc_pass_cb(void* cleanup_data) { sg_dealloc_pass({(uint32_t)(uintptr_t)cleanup_data}); }
 
+	sg_desc m_desc = {};
 	RENDER_COMMAND_ARRAY m_commands[2];
 	int32_t m_pending_commands_index = 0;
 	int32_t m_commit_commands_index = 1;
@@ -296,14 +738,139 @@ private:
 	SEMAPHORE m_update_semaphore;
 	SEMAPHORE m_render_semaphore;
 	std::atomic<bool> m_flushing = false;
+	std::atomic<bool> m_fast_teardown = false;
+	std::atomic<std::thread::id> m_render_thread_id;
+	uint32_t m_reset_count = 0;
+	std::chrono::steady_clock::time_point m_teardown_start_time;
+	std::atomic<double> m_teardown_time = 0.0;
 	int m_default_pass_width = 0;
 	int m_default_pass_height = 0;
 	std::mutex m_execute_mutex;
 	int32_t m_frame_index = 0;
+	int32_t m_commit_frame_index = 0;
+	std::atomic<int32_t> m_executed_frame_index = -1;
+	std::atomic<int32_t> m_number_of_fence_waiters = 0;
+	std::mutex m_fence_mutex;
+	std::condition_variable m_fence_cv;
+	std::atomic<TRACE*> m_trace = nullptr;
+	std::thread m_render_thread;
+	RENDER_THREAD_DESC m_render_thread_desc;
+	RENDER_RING* m_ring = nullptr;
+	uint32_t m_ring_handle_counters[RESOURCE_TYPE::COUNT] = {};
+	std::vector<uint32_t> m_ring_handles[RESOURCE_TYPE::COUNT];
+	std::vector<std::pair<RESOURCE_TYPE::ENUM, uint32_t>> m_ring_deallocs;
+	std::deque<std::pair<int32_t, uint32_t>> m_ring_free_handles[RESOURCE_TYPE::COUNT];
+	std::deque<std::string> m_ring_strings;
+	bool m_setup_on_render_thread = false;
+	std::atomic<bool> m_setup_complete = false;
+	std::atomic<bool> m_shutdown_complete = false;
+	uint32_t m_number_of_reserved_handles[RESOURCE_TYPE::COUNT] = {};
+	std::mutex m_handle_mutex;
+	bool m_partial_frame = false;
+	bool m_partial_frame_open = false;
+	std::deque<RENDER_COMMAND_ARRAY> m_partial_chunks;
+	std::vector<RENDER_COMMAND_ARRAY> m_free_partial_chunks;
+	std::mutex m_partial_mutex;
+	std::condition_variable m_partial_cv;
+	std::unique_ptr<sg_bindings[]> m_binding_set_pages[MAX_BINDING_SET_PAGES];
+	uint32_t m_number_of_binding_sets = 0;
+	uint32_t m_number_of_live_binding_sets = 0;
+	std::vector<uint32_t> m_binding_set_refs;
+	std::deque<std::pair<int32_t, uint32_t>> m_free_binding_sets;
+	std::unordered_map<uint64_t, uint32_t> m_binding_set_lookup;
+	uint32_t m_last_binding_set = 0;
+	std::vector<CULL_FRUSTUM> m_cull_frustums;
+	int32_t m_number_of_cull_frustums = 0;
+	std::vector<std::pair<int32_t, size_t>> m_cull_jobs;
+	WORKER_POOL m_worker_pool;
+	bool m_optimize_commands = false;
+	bool m_strip_debug_groups = false;
+	std::vector<std::pair<int32_t, bool>> m_optimize_debug_groups;
+	RENDER_STATS m_stats;
+	RENDER_STATS m_frame_stats;
+	bool m_dynamic_resolution = false;
+	RENDER_RESOLUTION_DESC m_resolution_desc;
+	float m_resolution_scale = 1.0f;
+	double m_smoothed_execute_time = 0.0;
+	double m_resolution_step_time = 0.0;
+	float m_resolution_step_scale = 1.0f;
+	float m_resolution_floor = 0.0f;
+	int32_t m_number_of_resolution_frames = 0;
+	int32_t m_resolution_frame_index = -1;
+	std::unordered_map<uint32_t, std::pair<int, int>> m_scalable_passes;
+	std::atomic<double> m_execute_time = 0.0;
+	float m_pass_resolution_scale = 1.0f;
+	int m_pass_width = 0;
+	int m_pass_height = 0;
+	bool m_record_manifest = false;
+	std::vector<MANIFEST_ENTRY> m_manifest_entries;
+	std::unordered_set<uint64_t> m_manifest_hashes;
+	std::unordered_map<uint32_t, uint64_t> m_manifest_shader_hashes;
+	std::vector<uint8_t> m_manifest_scratch;
+	std::vector<std::unique_ptr<PREWARM_ENTRY>> m_prewarm_entries;
+	std::unordered_map<uint64_t, PREWARM_ENTRY*> m_prewarm_lookup;
+	std::deque<PREWARM_ENTRY*> m_prewarm_queue;
+	std::mutex m_prewarm_mutex;
+	std::thread m_cleanup_thread;
+	bool m_stop_cleanup_thread = false;
+	void (*m_cleanup_dispatch_cb)(void (*run_cb)(void* run_data), void* run_data, void* user_data) = nullptr;
+	void* m_cleanup_dispatch_user_data = nullptr;
+	std::deque<CLEANUP_BATCH*> m_cleanup_batches;
+	std::vector<CLEANUP_BATCH*> m_free_cleanup_batches;
+	int32_t m_number_of_pending_cleanup_batches = 0;
+	std::mutex m_cleanup_mutex;
+	std::condition_variable m_cleanup_cv;
+	std::condition_variable m_cleanup_done_cv;
+	std::vector<TEXTURE_JOB*> m_finished_texture_jobs;
+	std::unordered_map<uint32_t, TEXTURE_IMAGE_JOBS> m_texture_jobs;
+	std::mutex m_texture_mutex;
 };
 
 // ----------------------------------------------------------------------------------------------------
 
+template <typename F> void RENDERER::add_command_custom(F&& fn)
+{
+	// types
+	typedef std::decay_t<F> CLOSURE;
+
+	// add command, type is set once the closure has been constructed
+	RENDER_COMMAND& command = m_commands[m_pending_commands_index].emplace_back(RENDER_COMMAND::TYPE::NOT_SET);
+
+	// small enough to store inline?
+	if constexpr (sizeof(CLOSURE) <= RENDER_COMMAND::MAX_INLINE_CLOSURE_SIZE && alignof(CLOSURE) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<CLOSURE>)
+	{
+		// construct closure in command
+		new (command.custom_closure.buf) CLOSURE(std::forward<F>(fn));
+		command.custom_closure.heap = nullptr;
+		command.custom_closure.destroy_cb = [](void* closure) { ((CLOSURE*)closure)->~CLOSURE(); };
+
+		// set relocate cb, trivially copyable closures are just copied with the command
+		if constexpr (std::is_trivially_copyable_v<CLOSURE>)
+		{
+			command.custom_closure.relocate_cb = nullptr;
+		}
+		else
+		{
+			command.custom_closure.relocate_cb = [](void* dst, void* src) { new (dst) CLOSURE(std::move(*(CLOSURE*)src)); ((CLOSURE*)src)->~CLOSURE(); };
+		}
+	}
+	else
+	{
+		// construct closure on heap
+		command.custom_closure.heap = new CLOSURE(std::forward<F>(fn));
+		command.custom_closure.destroy_cb = [](void* closure) { delete (CLOSURE*)closure; };
+		command.custom_closure.relocate_cb = nullptr;
+	}
+
+	// set invoke cb
+	command.custom_closure.invoke_cb = [](void* closure) { (*(CLOSURE*)closure)(); };
+
+	// set type
+	command.type = RENDER_COMMAND::TYPE::CUSTOM_CLOSURE;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
 typedef std::shared_ptr<RENDERER> RENDERER_REF;
 
 #endif
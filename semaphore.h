@@ -3,8 +3,15 @@
 
 // ----------------------------------------------------------------------------------------------------
 
+#include <atomic>
+#include <cstdint>
 #include <mutex>
 #include <condition_variable>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
 
 // ----------------------------------------------------------------------------------------------------
 
@@ -17,22 +24,64 @@ public:
 	void release()
 	{
 		std::scoped_lock<std::mutex> lock(m_mutex);
-		m_count ++;
+		m_count.fetch_add(1, std::memory_order_release);
 		m_cv.notify_one();
 	}
 	
 	void acquire()
 	{
+		if (try_acquire())
+		{
+			return;
+		}
+
 		std::unique_lock<std::mutex> lock(m_mutex);
-		while(!m_count)
+		while(!try_acquire())
 		{
 			m_cv.wait(lock);
 		}
-		m_count --;
+	}
+
+	bool try_acquire()
+	{
+		uint32_t count = m_count.load(std::memory_order_relaxed);
+		while (count)
+		{
+			if (m_count.compare_exchange_weak(count, count - 1, std::memory_order_acquire, std::memory_order_relaxed))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// spins without blocking, returns false if not acquired after spin_count attempts
+	bool spin_acquire(uint32_t spin_count)
+	{
+		for (uint32_t i = 0; i < spin_count; i ++)
+		{
+			if (try_acquire())
+			{
+				return true;
+			}
+			pause();
+		}
+		return false;
 	}
 	
 private:
-	uint32_t m_count = 0;
+	static void pause()
+	{
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+		_mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+		__asm__ __volatile__("yield");
+#else
+		std::this_thread::yield();
+#endif
+	}
+
+	std::atomic<uint32_t> m_count = 0;
 	std::mutex m_mutex;
 	std::condition_variable m_cv;
 };
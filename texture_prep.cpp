@@ -0,0 +1,526 @@
+// ----------------------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <intrin.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define TEXTURE_PREP_SIMD_X64
+#if defined(_MSC_VER) && !defined(__clang__)
+#define TEXTURE_PREP_TARGET_F16C
+#else
+#define TEXTURE_PREP_TARGET_F16C __attribute__((target("f16c")))
+#endif
+#endif
+
+#include "texture_prep.h"
+
+// ----------------------------------------------------------------------------------------------------
+
+constexpr int MAX_NUMBER_OF_MIPMAPS = SG_MAX_MIPMAPS;
+
+// ----------------------------------------------------------------------------------------------------
+
+static float half_to_float(uint16_t half)
+{
+	// split half
+	uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+	uint32_t exponent = (half >> 10) & 0x1f;
+	uint32_t mantissa = half & 0x3ff;
+
+	// subnormal, scale mantissa by 2^-24
+	if (!exponent)
+	{
+		float value = (float)mantissa * (1.0f / 16777216.0f);
+		return sign ? -value : value;
+	}
+
+	// infinity / nan, or rebias exponent
+	uint32_t bits = exponent == 0x1f ? sign | 0x7f800000 | (mantissa << 13) : sign | ((exponent + 112) << 23) | (mantissa << 13);
+
+	// return float
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+static uint16_t float_to_half(float value)
+{
+	// split float
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+	uint32_t magnitude = bits & 0x7fffffff;
+
+	// infinity / nan?
+	if (magnitude >= 0x7f800000)
+	{
+		return sign | 0x7c00 | (magnitude > 0x7f800000 ? 0x200 : 0);
+	}
+
+	// overflows to infinity?
+	if (magnitude >= 0x477ff000)
+	{
+		return sign | 0x7c00;
+	}
+
+	// subnormal or zero, round mantissa scaled by 2^24 to nearest even
+	if (magnitude < 0x38800000)
+	{
+		float subnormal;
+		memcpy(&subnormal, &magnitude, sizeof(subnormal));
+		return sign | (uint16_t)lrintf(subnormal * 16777216.0f);
+	}
+
+	// normal, round to nearest even and rebias exponent
+	uint32_t rounded = magnitude + 0xfff + ((magnitude >> 13) & 1);
+	return sign | (uint16_t)((rounded - 0x38000000) >> 13);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+static uint8_t float_to_unorm8(float value)
+{
+	// clamp and round
+	return (uint8_t)(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+static void load_pixel(const uint8_t* source, sg_pixel_format pixel_format, float* rgba)
+{
+	// decode pixel
+	switch (pixel_format)
+	{
+		case SG_PIXELFORMAT_R8:
+			rgba[0] = source[0] * (1.0f / 255.0f);
+			rgba[1] = 0.0f;
+			rgba[2] = 0.0f;
+			rgba[3] = 1.0f;
+			break;
+		case SG_PIXELFORMAT_RGBA8:
+			for (int i = 0; i < 4; i ++)
+			{
+				rgba[i] = source[i] * (1.0f / 255.0f);
+			}
+			break;
+		case SG_PIXELFORMAT_BGRA8:
+			rgba[0] = source[2] * (1.0f / 255.0f);
+			rgba[1] = source[1] * (1.0f / 255.0f);
+			rgba[2] = source[0] * (1.0f / 255.0f);
+			rgba[3] = source[3] * (1.0f / 255.0f);
+			break;
+		case SG_PIXELFORMAT_RGBA16F:
+			for (int i = 0; i < 4; i ++)
+			{
+				uint16_t half;
+				memcpy(&half, source + i * 2, sizeof(half));
+				rgba[i] = half_to_float(half);
+			}
+			break;
+		case SG_PIXELFORMAT_RGBA32F:
+			memcpy(rgba, source, sizeof(float) * 4);
+			break;
+		default:
+			break;
+	}
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+static void store_pixel(uint8_t* dest, sg_pixel_format pixel_format, const float* rgba)
+{
+	// encode pixel
+	switch (pixel_format)
+	{
+		case SG_PIXELFORMAT_R8:
+			dest[0] = float_to_unorm8(rgba[0]);
+			break;
+		case SG_PIXELFORMAT_RGBA8:
+			for (int i = 0; i < 4; i ++)
+			{
+				dest[i] = float_to_unorm8(rgba[i]);
+			}
+			break;
+		case SG_PIXELFORMAT_BGRA8:
+			dest[0] = float_to_unorm8(rgba[2]);
+			dest[1] = float_to_unorm8(rgba[1]);
+			dest[2] = float_to_unorm8(rgba[0]);
+			dest[3] = float_to_unorm8(rgba[3]);
+			break;
+		case SG_PIXELFORMAT_RGBA16F:
+			for (int i = 0; i < 4; i ++)
+			{
+				uint16_t half = float_to_half(rgba[i]);
+				memcpy(dest + i * 2, &half, sizeof(half));
+			}
+			break;
+		case SG_PIXELFORMAT_RGBA32F:
+			memcpy(dest, rgba, sizeof(float) * 4);
+			break;
+		default:
+			break;
+	}
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+static void downsample_unorm8(const uint8_t* row0, const uint8_t* row1, uint8_t* dest, int begin, int width, int source_width, int channels)
+{
+	// loop through pixels, clamping the right hand column of one pixel wide sources
+	for (int x = begin; x < width; x ++)
+	{
+		const int x0 = x * 2 * channels;
+		const int x1 = std::min(x * 2 + 1, source_width - 1) * channels;
+		for (int c = 0; c < channels; c ++)
+		{
+			dest[x * channels + c] = (uint8_t)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+static void downsample_float(const float* row0, const float* row1, float* dest, int begin, int width, int source_width)
+{
+	// loop through pixels, clamping the right hand column of one pixel wide sources
+	for (int x = begin; x < width; x ++)
+	{
+		const int x0 = x * 2 * 4;
+		const int x1 = std::min(x * 2 + 1, source_width - 1) * 4;
+		for (int c = 0; c < 4; c ++)
+		{
+			dest[x * 4 + c] = (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c]) * 0.25f;
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+static void downsample_half(const uint16_t* row0, const uint16_t* row1, uint16_t* dest, int begin, int width, int source_width)
+{
+	// loop through pixels, clamping the right hand column of one pixel wide sources
+	for (int x = begin; x < width; x ++)
+	{
+		const int x0 = x * 2 * 4;
+		const int x1 = std::min(x * 2 + 1, source_width - 1) * 4;
+		for (int c = 0; c < 4; c ++)
+		{
+			dest[x * 4 + c] = float_to_half((half_to_float(row0[x0 + c]) + half_to_float(row0[x1 + c]) + half_to_float(row1[x0 + c]) + half_to_float(row1[x1 + c])) * 0.25f);
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+#if defined(TEXTURE_PREP_SIMD_X64)
+
+static int downsample_rgba8_sse2(const uint8_t* row0, const uint8_t* row1, uint8_t* dest, int width)
+{
+	// loop through pairs of pixels, widening to 16 bits so the 2x2 sum can't overflow
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i round = _mm_set1_epi16(2);
+	int x = 0;
+	for (; x + 2 <= width; x += 2)
+	{
+		// sum rows, lo holds source pixels 0 and 1, hi holds 2 and 3
+		__m128i a = _mm_loadu_si128((const __m128i*)(row0 + x * 8));
+		__m128i b = _mm_loadu_si128((const __m128i*)(row1 + x * 8));
+		__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+		__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+
+		// sum columns
+		lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+		hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+
+		// average and store two pixels
+		__m128i sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(lo, hi), round), 2);
+		_mm_storel_epi64((__m128i*)(dest + x * 4), _mm_packus_epi16(sum, zero));
+	}
+
+	// return first pixel not written
+	return x;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+static int downsample_r8_sse2(const uint8_t* row0, const uint8_t* row1, uint8_t* dest, int width)
+{
+	// loop through runs of eight pixels
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i ones = _mm_set1_epi16(1);
+	const __m128i round = _mm_set1_epi16(2);
+	int x = 0;
+	for (; x + 8 <= width; x += 8)
+	{
+		// sum rows
+		__m128i a = _mm_loadu_si128((const __m128i*)(row0 + x * 2));
+		__m128i b = _mm_loadu_si128((const __m128i*)(row1 + x * 2));
+		__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+		__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+
+		// sum adjacent columns
+		__m128i sum = _mm_packs_epi32(_mm_madd_epi16(lo, ones), _mm_madd_epi16(hi, ones));
+
+		// average and store eight pixels
+		sum = _mm_srli_epi16(_mm_add_epi16(sum, round), 2);
+		_mm_storel_epi64((__m128i*)(dest + x), _mm_packus_epi16(sum, zero));
+	}
+
+	// return first pixel not written
+	return x;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+static int downsample_rgba32f_sse(const float* row0, const float* row1, float* dest, int width)
+{
+	// loop through pixels, one pixel per register
+	const __m128 quarter = _mm_set1_ps(0.25f);
+	for (int x = 0; x < width; x ++)
+	{
+		__m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(row0 + x * 8), _mm_loadu_ps(row0 + x * 8 + 4)), _mm_add_ps(_mm_loadu_ps(row1 + x * 8), _mm_loadu_ps(row1 + x * 8 + 4)));
+		_mm_storeu_ps(dest + x * 4, _mm_mul_ps(sum, quarter));
+	}
+
+	// return first pixel not written
+	return width;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+TEXTURE_PREP_TARGET_F16C static int downsample_rgba16f_f16c(const uint16_t* row0, const uint16_t* row1, uint16_t* dest, int width)
+{
+	// loop through pixels, widening to floats one pixel per register
+	const __m128 quarter = _mm_set1_ps(0.25f);
+	for (int x = 0; x < width; x ++)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*)(row0 + x * 8));
+		__m128i b = _mm_loadu_si128((const __m128i*)(row1 + x * 8));
+		__m128 sum = _mm_add_ps(_mm_add_ps(_mm_cvtph_ps(a), _mm_cvtph_ps(_mm_srli_si128(a, 8))), _mm_add_ps(_mm_cvtph_ps(b), _mm_cvtph_ps(_mm_srli_si128(b, 8))));
+		_mm_storel_epi64((__m128i*)(dest + x * 4), _mm_cvtps_ph(_mm_mul_ps(sum, quarter), _MM_FROUND_TO_NEAREST_INT));
+	}
+
+	// return first pixel not written
+	return width;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+TEXTURE_PREP_TARGET_F16C static void convert_rgba32f_to_rgba16f_f16c(const float* source, uint16_t* dest, size_t number_of_pixels)
+{
+	// loop through pixels
+	for (size_t i = 0; i < number_of_pixels; i ++)
+	{
+		_mm_storel_epi64((__m128i*)(dest + i * 4), _mm_cvtps_ph(_mm_loadu_ps(source + i * 4), _MM_FROUND_TO_NEAREST_INT));
+	}
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+static bool has_f16c()
+{
+#if defined(_WIN32)
+	// needs f16c and avx state enabled by the os
+	int info[4];
+	__cpuid(info, 1);
+	return (info[2] & (1 << 29)) && (info[2] & (1 << 28)) && (info[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6;
+#else
+	return __builtin_cpu_supports("f16c");
+#endif
+}
+
+#endif
+
+// ----------------------------------------------------------------------------------------------------
+
+bool TEXTURE_PREP::is_supported(sg_pixel_format pixel_format)
+{
+	return get_bytes_per_pixel(pixel_format) != 0;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+int TEXTURE_PREP::get_bytes_per_pixel(sg_pixel_format pixel_format)
+{
+	// get bytes per pixel, 0 if unsupported
+	switch (pixel_format)
+	{
+		case SG_PIXELFORMAT_R8:
+			return 1;
+		case SG_PIXELFORMAT_RGBA8:
+		case SG_PIXELFORMAT_BGRA8:
+			return 4;
+		case SG_PIXELFORMAT_RGBA16F:
+			return 8;
+		case SG_PIXELFORMAT_RGBA32F:
+			return 16;
+		default:
+			return 0;
+	}
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+int TEXTURE_PREP::get_number_of_mipmaps(int width, int height)
+{
+	// halve largest dimension down to one pixel
+	int number_of_mipmaps = 1;
+	for (int size = std::max(width, height); size > 1 && number_of_mipmaps < MAX_NUMBER_OF_MIPMAPS; size /= 2)
+	{
+		number_of_mipmaps ++;
+	}
+	return number_of_mipmaps;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+size_t TEXTURE_PREP::get_size(sg_pixel_format pixel_format, int width, int height, int number_of_mipmaps)
+{
+	// loop through mipmaps
+	size_t size = 0;
+	for (int i = 0; i < number_of_mipmaps; i ++)
+	{
+		size += (size_t)width * (size_t)height * (size_t)get_bytes_per_pixel(pixel_format);
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+	}
+	return size;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+bool TEXTURE_PREP::prepare(const void* source, sg_pixel_format source_pixel_format, int width, int height, sg_pixel_format pixel_format, int number_of_mipmaps, void* dest, sg_range* mipmaps)
+{
+	// invalid?
+	if (!source || !dest || !is_supported(source_pixel_format) || !is_supported(pixel_format) || width <= 0 || height <= 0 || number_of_mipmaps < 1 || number_of_mipmaps > MAX_NUMBER_OF_MIPMAPS)
+	{
+		return false;
+	}
+
+	// convert top mipmap
+	const size_t bytes_per_pixel = (size_t)get_bytes_per_pixel(pixel_format);
+	convert(source, source_pixel_format, dest, pixel_format, (size_t)width * (size_t)height);
+	mipmaps[0] = { dest, (size_t)width * (size_t)height * bytes_per_pixel };
+
+	// loop through remaining mipmaps, each filtered from the one above
+	for (int i = 1; i < number_of_mipmaps; i ++)
+	{
+		const int mipmap_width = std::max(width / 2, 1);
+		const int mipmap_height = std::max(height / 2, 1);
+		uint8_t* mipmap = (uint8_t*)mipmaps[i - 1].ptr + mipmaps[i - 1].size;
+		downsample(mipmaps[i - 1].ptr, width, height, mipmap, mipmap_width, mipmap_height, pixel_format);
+		mipmaps[i] = { mipmap, (size_t)mipmap_width * (size_t)mipmap_height * bytes_per_pixel };
+		width = mipmap_width;
+		height = mipmap_height;
+	}
+
+	return true;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void TEXTURE_PREP::convert(const void* source, sg_pixel_format source_pixel_format, void* dest, sg_pixel_format pixel_format, size_t number_of_pixels)
+{
+	// same format?
+	if (source_pixel_format == pixel_format)
+	{
+		memcpy(dest, source, number_of_pixels * (size_t)get_bytes_per_pixel(pixel_format));
+		return;
+	}
+
+	// swizzle?
+	if ((source_pixel_format == SG_PIXELFORMAT_RGBA8 && pixel_format == SG_PIXELFORMAT_BGRA8) || (source_pixel_format == SG_PIXELFORMAT_BGRA8 && pixel_format == SG_PIXELFORMAT_RGBA8))
+	{
+		const uint8_t* src = (const uint8_t*)source;
+		uint8_t* dst = (uint8_t*)dest;
+		for (size_t i = 0; i < number_of_pixels * 4; i += 4)
+		{
+			dst[i + 0] = src[i + 2];
+			dst[i + 1] = src[i + 1];
+			dst[i + 2] = src[i + 0];
+			dst[i + 3] = src[i + 3];
+		}
+		return;
+	}
+
+#if defined(TEXTURE_PREP_SIMD_X64)
+	// narrow floats in hardware?
+	static const bool f16c = has_f16c();
+	if (f16c && source_pixel_format == SG_PIXELFORMAT_RGBA32F && pixel_format == SG_PIXELFORMAT_RGBA16F)
+	{
+		convert_rgba32f_to_rgba16f_f16c((const float*)source, (uint16_t*)dest, number_of_pixels);
+		return;
+	}
+#endif
+
+	// loop through pixels, going through floats
+	const size_t source_bytes_per_pixel = (size_t)get_bytes_per_pixel(source_pixel_format);
+	const size_t bytes_per_pixel = (size_t)get_bytes_per_pixel(pixel_format);
+	for (size_t i = 0; i < number_of_pixels; i ++)
+	{
+		float rgba[4] = {};
+		load_pixel((const uint8_t*)source + i * source_bytes_per_pixel, source_pixel_format, rgba);
+		store_pixel((uint8_t*)dest + i * bytes_per_pixel, pixel_format, rgba);
+	}
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void TEXTURE_PREP::downsample(const void* source, int source_width, int source_height, void* dest, int width, int height, sg_pixel_format pixel_format)
+{
+#if defined(TEXTURE_PREP_SIMD_X64)
+	static const bool f16c = has_f16c();
+#endif
+
+	// loop through rows, clamping the bottom row of one pixel high sources
+	const size_t bytes_per_pixel = (size_t)get_bytes_per_pixel(pixel_format);
+	const size_t source_pitch = (size_t)source_width * bytes_per_pixel;
+	const size_t pitch = (size_t)width * bytes_per_pixel;
+	for (int y = 0; y < height; y ++)
+	{
+		const uint8_t* row0 = (const uint8_t*)source + (size_t)(y * 2) * source_pitch;
+		const uint8_t* row1 = (const uint8_t*)source + (size_t)std::min(y * 2 + 1, source_height - 1) * source_pitch;
+		uint8_t* row = (uint8_t*)dest + (size_t)y * pitch;
+
+		// filter with simd while both source columns are in range, then finish the row
+		int x = 0;
+		switch (pixel_format)
+		{
+			case SG_PIXELFORMAT_R8:
+#if defined(TEXTURE_PREP_SIMD_X64)
+				x = source_width > 1 ? downsample_r8_sse2(row0, row1, row, width) : 0;
+#endif
+				downsample_unorm8(row0, row1, row, x, width, source_width, 1);
+				break;
+			case SG_PIXELFORMAT_RGBA8:
+			case SG_PIXELFORMAT_BGRA8:
+#if defined(TEXTURE_PREP_SIMD_X64)
+				x = source_width > 1 ? downsample_rgba8_sse2(row0, row1, row, width) : 0;
+#endif
+				downsample_unorm8(row0, row1, row, x, width, source_width, 4);
+				break;
+			case SG_PIXELFORMAT_RGBA16F:
+#if defined(TEXTURE_PREP_SIMD_X64)
+				x = source_width > 1 && f16c ? downsample_rgba16f_f16c((const uint16_t*)row0, (const uint16_t*)row1, (uint16_t*)row, width) : 0;
+#endif
+				downsample_half((const uint16_t*)row0, (const uint16_t*)row1, (uint16_t*)row, x, width, source_width);
+				break;
+			case SG_PIXELFORMAT_RGBA32F:
+#if defined(TEXTURE_PREP_SIMD_X64)
+				x = source_width > 1 ? downsample_rgba32f_sse((const float*)row0, (const float*)row1, (float*)row, width) : 0;
+#endif
+				downsample_float((const float*)row0, (const float*)row1, (float*)row, x, width, source_width);
+				break;
+			default:
+				break;
+		}
+	}
+}
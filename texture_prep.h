@@ -0,0 +1,31 @@
+#ifndef TEXTURE_PREP_H
+#define TEXTURE_PREP_H
+
+// ----------------------------------------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+
+#include "sokol_gfx.h"
+
+// ----------------------------------------------------------------------------------------------------
+
+// converts pixels between formats and builds box filtered mipmap chains, thread safe
+// supported formats are R8, RGBA8, BGRA8, RGBA16F and RGBA32F, R8 converts to and from (r, 0, 0, 1) like the gpu samples it
+class TEXTURE_PREP
+{
+public:
+	static bool is_supported(sg_pixel_format pixel_format);
+	static int get_bytes_per_pixel(sg_pixel_format pixel_format);
+	static int get_number_of_mipmaps(int width, int height);
+	static size_t get_size(sg_pixel_format pixel_format, int width, int height, int number_of_mipmaps);
+
+	// converts source to pixel_format and fills dest with number_of_mipmaps levels, dest must be get_size() bytes
+	static bool prepare(const void* source, sg_pixel_format source_pixel_format, int width, int height, sg_pixel_format pixel_format, int number_of_mipmaps, void* dest, sg_range* mipmaps);
+
+private:
+	static void convert(const void* source, sg_pixel_format source_pixel_format, void* dest, sg_pixel_format pixel_format, size_t number_of_pixels);
+	static void downsample(const void* source, int source_width, int source_height, void* dest, int width, int height, sg_pixel_format pixel_format);
+};
+
+#endif
@@ -0,0 +1,209 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// ----------------------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+
+// ----------------------------------------------------------------------------------------------------
+
+class TRACE
+{
+public:
+	// types
+	struct THREAD
+	{
+		enum ENUM
+		{
+			UPDATE = 0,
+			RENDER,
+
+			COUNT
+		};
+	};
+
+	TRACE(uint32_t number_of_events_per_thread)
+	{
+		// round up to power of two
+		uint32_t capacity = 1;
+		while (capacity < number_of_events_per_thread)
+		{
+			capacity <<= 1;
+		}
+
+		// loop through threads
+		for (auto& thread : m_threads)
+		{
+			// allocate events
+			thread.events.resize(capacity);
+		}
+
+		// set mask
+		m_mask = capacity - 1;
+
+		// set start time
+		m_start_time = std::chrono::steady_clock::now();
+	}
+	~TRACE() {}
+
+	void set_enabled(bool enabled) { m_enabled.store(enabled, std::memory_order_relaxed); }
+	bool is_enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+	// only ever called from the thread that owns the ring
+	void begin(THREAD::ENUM thread, const char* name) { add_event(thread, name, true); }
+	void end(THREAD::ENUM thread) { add_event(thread, nullptr, false); }
+
+	// writes chrome trace / perfetto json, can be called from any thread
+	bool write(const char* filename) const
+	{
+		// open file
+		FILE* file = fopen(filename, "w");
+
+		// failed?
+		if (!file)
+		{
+			return false;
+		}
+
+		// write header
+		fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+		fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"update\"}},\n", THREAD::UPDATE + 1);
+		fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"render\"}}", THREAD::RENDER + 1);
+
+		// loop through threads
+		for (int32_t thread_index = 0; thread_index < THREAD::COUNT; thread_index ++)
+		{
+			// snapshot events
+			std::vector<EVENT> events;
+			snapshot(m_threads[thread_index], events);
+
+			// loop through events
+			int32_t depth = 0;
+			for (const auto& event : events)
+			{
+				// ignore end without begin (begin lost to ring wrap)?
+				if (!event.begin && !depth)
+				{
+					continue;
+				}
+
+				// update depth
+				depth += event.begin ? 1 : -1;
+
+				// write event
+				double ts = (double)event.timestamp / 1000.0;
+				if (event.begin)
+				{
+					fprintf(file, ",\n{\"name\":\"");
+					write_escaped(file, event.name);
+					fprintf(file, "\",\"ph\":\"B\",\"pid\":1,\"tid\":%d,\"ts\":%.3f}", thread_index + 1, ts);
+				}
+				else
+				{
+					fprintf(file, ",\n{\"ph\":\"E\",\"pid\":1,\"tid\":%d,\"ts\":%.3f}", thread_index + 1, ts);
+				}
+			}
+		}
+
+		// write footer
+		fprintf(file, "\n]}\n");
+
+		// close file
+		return fclose(file) == 0;
+	}
+
+private:
+	struct EVENT
+	{
+		int64_t timestamp = 0;
+		bool begin = false;
+		char name[47] = {};
+	};
+
+	struct THREAD_EVENTS
+	{
+		std::vector<EVENT> events;
+		std::atomic<uint64_t> count = 0;
+	};
+
+	void add_event(THREAD::ENUM thread, const char* name, bool begin)
+	{
+		// disabled?
+		if (!is_enabled())
+		{
+			return;
+		}
+
+		// get next event, single producer so no need for atomic increment
+		THREAD_EVENTS& thread_events = m_threads[thread];
+		uint64_t count = thread_events.count.load(std::memory_order_relaxed);
+		EVENT& event = thread_events.events[count & m_mask];
+
+		// fill in event
+		event.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start_time).count();
+		event.begin = begin;
+		if (name)
+		{
+			strncpy(event.name, name, sizeof(event.name) - 1);
+			event.name[sizeof(event.name) - 1] = 0;
+		}
+
+		// publish event
+		thread_events.count.store(count + 1, std::memory_order_release);
+	}
+
+	void snapshot(const THREAD_EVENTS& thread_events, std::vector<EVENT>& events) const
+	{
+		// get range of events still in ring
+		uint64_t capacity = (uint64_t)m_mask + 1;
+		uint64_t end = thread_events.count.load(std::memory_order_acquire);
+		uint64_t start = end > capacity ? end - capacity : 0;
+
+		// copy events
+		events.reserve((size_t)(end - start));
+		for (uint64_t i = start; i < end; i ++)
+		{
+			events.push_back(thread_events.events[i & m_mask]);
+		}
+
+		// drop any events the producer may have overwritten while copying, including the slot it may be writing now, which isn't published yet
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint64_t new_end = thread_events.count.load(std::memory_order_relaxed);
+		uint64_t overwritten = new_end + 1 > capacity ? new_end + 1 - capacity : 0;
+		if (overwritten > start)
+		{
+			events.erase(events.begin(), events.begin() + (size_t)std::min(overwritten - start, end - start));
+		}
+	}
+
+	static void write_escaped(FILE* file, const char* name)
+	{
+		// loop through characters
+		for (const char* c = name; *c; c ++)
+		{
+			// escape?
+			if (*c == '"' || *c == '\\')
+			{
+				fputc('\\', file);
+			}
+
+			// ignore control characters
+			if ((unsigned char)*c >= 0x20)
+			{
+				fputc(*c, file);
+			}
+		}
+	}
+
+	THREAD_EVENTS m_threads[THREAD::COUNT];
+	uint32_t m_mask = 0;
+	std::chrono::steady_clock::time_point m_start_time;
+	std::atomic<bool> m_enabled = false;
+};
+
+#endif
@@ -0,0 +1,191 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+// ----------------------------------------------------------------------------------------------------
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <utility>
+#include <vector>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+
+// ----------------------------------------------------------------------------------------------------
+
+class WORKER_POOL
+{
+public:
+	WORKER_POOL() {}
+	~WORKER_POOL() { stop(); }
+
+	WORKER_POOL(const WORKER_POOL&) = delete;
+	WORKER_POOL& operator=(const WORKER_POOL&) = delete;
+
+	void start(int32_t number_of_threads)
+	{
+		// already started?
+		if (!m_threads.empty())
+		{
+			return;
+		}
+
+		// start threads
+		m_stop = false;
+		for (int32_t i = 0; i < number_of_threads; i ++)
+		{
+			m_threads.emplace_back(&WORKER_POOL::thread_loop, this);
+		}
+	}
+
+	void stop()
+	{
+		// not started?
+		if (m_threads.empty())
+		{
+			return;
+		}
+
+		// signal threads to exit, once they have drained the queued jobs
+		{
+			std::scoped_lock<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+		m_cv.notify_all();
+
+		// wait for threads to exit
+		for (auto& thread : m_threads)
+		{
+			thread.join();
+		}
+		m_threads.clear();
+	}
+
+	int32_t get_number_of_threads() const { return (int32_t)m_threads.size(); }
+
+	// calls fn(index) for every index in [0, count) on the workers and the calling thread, returns once all calls are done
+	template <typename F> void parallel_for(size_t count, F&& fn)
+	{
+		// not worth waking workers?
+		if (m_threads.empty() || count <= 1)
+		{
+			for (size_t i = 0; i < count; i ++)
+			{
+				fn(i);
+			}
+			return;
+		}
+
+		// open job
+		{
+			std::scoped_lock<std::mutex> lock(m_mutex);
+			m_fn = (void*)&fn;
+			m_invoke_cb = [](void* fn, size_t index) { (*(std::remove_reference_t<F>*)fn)(index); };
+			m_next_index.store(0, std::memory_order_relaxed);
+			m_count = count;
+			m_open = true;
+			m_generation ++;
+		}
+		m_cv.notify_all();
+
+		// help out
+		run_job();
+
+		// close job and wait for workers still running it
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_open = false;
+		m_done_cv.wait(lock, [this]() { return m_number_of_active_threads == 0; });
+	}
+
+	// queues job_cb(job_data) to run on a worker, runs it immediately on the calling thread if there are no workers
+	void submit(void (*job_cb)(void* job_data), void* job_data)
+	{
+		// no workers?
+		if (m_threads.empty())
+		{
+			job_cb(job_data);
+			return;
+		}
+
+		// queue job
+		{
+			std::scoped_lock<std::mutex> lock(m_mutex);
+			m_jobs.emplace_back(job_cb, job_data);
+		}
+		m_cv.notify_one();
+	}
+
+private:
+	void run_job()
+	{
+		// loop through indices
+		for (size_t i = m_next_index.fetch_add(1, std::memory_order_relaxed); i < m_count; i = m_next_index.fetch_add(1, std::memory_order_relaxed))
+		{
+			m_invoke_cb(m_fn, i);
+		}
+	}
+
+	void thread_loop()
+	{
+		// loop until stopped
+		uint64_t generation = 0;
+		std::unique_lock<std::mutex> lock(m_mutex);
+		for (;;)
+		{
+			// wait for job
+			m_cv.wait(lock, [&]() { return m_stop || (m_open && m_generation != generation) || !m_jobs.empty(); });
+
+			// queued job, parallel_for() jobs go first as their caller is blocked on them?
+			if (!m_jobs.empty() && !(m_open && m_generation != generation))
+			{
+				// run job without holding the lock
+				std::pair<void (*)(void* job_data), void*> job = m_jobs.front();
+				m_jobs.pop_front();
+				lock.unlock();
+				job.first(job.second);
+				lock.lock();
+				continue;
+			}
+
+			// stopped?
+			if (m_stop)
+			{
+				return;
+			}
+
+			// join job
+			generation = m_generation;
+			m_number_of_active_threads ++;
+
+			// run job without holding the lock
+			lock.unlock();
+			run_job();
+			lock.lock();
+
+			// leave job
+			if (-- m_number_of_active_threads == 0)
+			{
+				m_done_cv.notify_all();
+			}
+		}
+	}
+
+	std::vector<std::thread> m_threads;
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	std::condition_variable m_done_cv;
+	bool m_stop = false;
+	bool m_open = false;
+	uint64_t m_generation = 0;
+	int32_t m_number_of_active_threads = 0;
+	void* m_fn = nullptr;
+	void (*m_invoke_cb)(void* fn, size_t index) = nullptr;
+	size_t m_count = 0;
+	std::atomic<size_t> m_next_index = 0;
+	std::deque<std::pair<void (*)(void* job_data), void*>> m_jobs;
+};
+
+#endif